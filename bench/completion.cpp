@@ -0,0 +1,67 @@
+#include "loopback_server.h"
+
+#include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/sync_wait.h>
+#include <asyncpp/task.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace asyncpp;
+using namespace asyncpp::curl;
+using clock_type = std::chrono::steady_clock;
+
+/*
+ * Measures the time between curl delivering the last chunk of a response and the awaiting coroutine being resumed.
+ * The "queue hop" column adds one extra round trip through the executor queue, which is what the completion path used to cost.
+ */
+namespace {
+	struct queue_hop {
+		executor& m_exec;
+		constexpr bool await_ready() const noexcept { return false; }
+		void await_suspend(coroutine_handle<> h) { m_exec.push([h]() { h.resume(); }); }
+		constexpr void await_resume() const noexcept {}
+	};
+
+	task<std::vector<double>> run(executor& exec, std::string url, size_t count, bool hop) {
+		std::vector<double> result;
+		result.reserve(count);
+		handle hdl;
+		clock_type::time_point last_write;
+		hdl.set_url(url);
+		hdl.set_writefunction([&last_write](char*, size_t size) {
+			last_write = clock_type::now();
+			return size;
+		});
+		for (size_t i = 0; i < count; i++) {
+			co_await exec.exec(hdl);
+			if (hop) co_await queue_hop{exec};
+			result.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - last_write).count());
+		}
+		co_return result;
+	}
+
+	double percentile(std::vector<double>& values, double p) {
+		std::sort(values.begin(), values.end());
+		return values[static_cast<size_t>(p * (values.size() - 1))];
+	}
+} // namespace
+
+int main(int argc, const char** argv) {
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 10000;
+	loopback_http_server server;
+	std::printf("%-15s %-10s %10s %10s\n", "mode", "path", "p50 (us)", "p99 (us)");
+	for (auto mode : {executor::loop_mode::poll, executor::loop_mode::socket_action}) {
+		executor exec{executor::options{.mode = mode}};
+		for (bool hop : {false, true}) {
+			auto values = as_promise(run(exec, server.url(), count, hop)).get();
+			std::printf("%-15s %-10s %10.1f %10.1f\n", mode == executor::loop_mode::poll ? "poll" : "socket_action", hop ? "queue hop" : "direct",
+						percentile(values, 0.5), percentile(values, 0.99));
+		}
+	}
+	return 0;
+}
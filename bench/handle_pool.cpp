@@ -0,0 +1,58 @@
+#include "loopback_server.h"
+
+#include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/handle_pool.h>
+#include <asyncpp/sync_wait.h>
+#include <asyncpp/task.h>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+using namespace asyncpp;
+using namespace asyncpp::curl;
+using clock_type = std::chrono::steady_clock;
+
+/*
+ * Measures request throughput when every request uses a freshly created easy handle compared to
+ * reusing handles from a handle_pool. Connections are cached in the multi handle either way,
+ * so the difference is the cost of creating, configuring and destroying the easy handle.
+ */
+namespace {
+	void configure(handle& hdl, const std::string& url) {
+		hdl.set_url(url);
+		hdl.set_writefunction([](char*, size_t size) { return size; });
+	}
+
+	task<void> run(executor& exec, std::string url, size_t count, bool pooled) {
+		for (size_t i = 0; i < count; i++) {
+			if (pooled) {
+				auto hdl = exec.handles().acquire();
+				configure(*hdl, url);
+				co_await exec.exec(*hdl);
+			} else {
+				auto hdl = std::make_unique<handle>();
+				configure(*hdl, url);
+				co_await exec.exec(*hdl);
+			}
+		}
+	}
+} // namespace
+
+int main(int argc, const char** argv) {
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 20000;
+	loopback_http_server server;
+	executor exec;
+	std::printf("%-10s %12s\n", "handles", "req/s");
+	for (bool pooled : {false, true}) {
+		// Warm up the connection cache
+		as_promise(run(exec, server.url(), 100, pooled)).get();
+		auto start = clock_type::now();
+		as_promise(run(exec, server.url(), count, pooled)).get();
+		auto secs = std::chrono::duration<double>(clock_type::now() - start).count();
+		std::printf("%-10s %12.0f\n", pooled ? "pooled" : "fresh", count / secs);
+	}
+	return 0;
+}
@@ -0,0 +1,107 @@
+#include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/tcp_client.h>
+#include <asyncpp/sync_wait.h>
+#include <asyncpp/task.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace asyncpp;
+using namespace asyncpp::curl;
+using clock_type = std::chrono::steady_clock;
+
+/*
+ * Measures the delivery latency of small messages pushed by a loopback server to a tcp_client,
+ * i.e. the time between the server writing a message and the receiving coroutine being resumed.
+ * Messages are sent with a pause in between, so the executor goes idle before each message like it would for a market data feed.
+ */
+namespace {
+	class feed_server {
+		int m_fd;
+		uint16_t m_port;
+
+	public:
+		feed_server() {
+			m_fd = socket(AF_INET, SOCK_STREAM, 0);
+			sockaddr_in addr{};
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t len = sizeof(addr);
+			if (bind(m_fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || listen(m_fd, 16) != 0 ||
+				getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+				throw std::runtime_error("failed to create server socket");
+			m_port = ntohs(addr.sin_port);
+		}
+		~feed_server() { close(m_fd); }
+		feed_server(const feed_server&) = delete;
+		feed_server& operator=(const feed_server&) = delete;
+
+		uint16_t port() const noexcept { return m_port; }
+
+		// Accept a single client and send it count timestamps
+		std::thread serve(size_t count, std::chrono::microseconds interval) {
+			return std::thread([this, count, interval]() {
+				int client = accept(m_fd, nullptr, nullptr);
+				int one = 1;
+				setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+				for (size_t i = 0; i < count; i++) {
+					std::this_thread::sleep_for(interval);
+					auto now = clock_type::now().time_since_epoch().count();
+					if (write(client, &now, sizeof(now)) != sizeof(now)) break;
+				}
+				close(client);
+			});
+		}
+	};
+
+	task<std::vector<double>> run(executor& exec, uint16_t port, size_t count) {
+		std::vector<double> result;
+		result.reserve(count);
+		tcp_client client{exec};
+		co_await client.connect("127.0.0.1", port, false);
+		for (size_t i = 0; i < count; i++) {
+			clock_type::rep sent;
+			if (co_await client.recv_all(&sent, sizeof(sent)) != sizeof(sent)) break;
+			auto delay = clock_type::now() - clock_type::time_point{clock_type::duration{sent}};
+			result.push_back(std::chrono::duration<double, std::micro>(delay).count());
+		}
+		co_await client.disconnect();
+		co_return result;
+	}
+
+	double percentile(std::vector<double>& values, double p) {
+		std::sort(values.begin(), values.end());
+		return values[static_cast<size_t>(p * (values.size() - 1))];
+	}
+} // namespace
+
+int main(int argc, const char** argv) {
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 10000;
+	const std::chrono::microseconds interval{argc > 2 ? std::stoul(argv[2]) : 100};
+	feed_server server;
+	std::printf("%-15s %-12s %10s %10s\n", "mode", "busy poll", "p50 (us)", "p99 (us)");
+	for (auto mode : {executor::loop_mode::poll, executor::loop_mode::socket_action}) {
+		for (auto spin : {std::chrono::microseconds{0}, std::chrono::microseconds{1000}}) {
+			executor exec{executor::options{.mode = mode, .busy_poll = spin}};
+			auto feed = server.serve(count, interval);
+			auto values = as_promise(run(exec, server.port(), count)).get();
+			feed.join();
+			if (values.empty()) continue;
+			std::printf("%-15s %-12s %10.1f %10.1f\n", mode == executor::loop_mode::poll ? "poll" : "socket_action",
+						(std::to_string(spin.count()) + " us").c_str(), percentile(values, 0.5), percentile(values, 0.99));
+		}
+	}
+	return 0;
+}
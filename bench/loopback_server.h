@@ -0,0 +1,78 @@
+#pragma once
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+/**
+ * \brief Minimal HTTP/1.1 keep-alive server on the loopback interface, used by the benchmarks.
+ *
+ * Every request is answered with a fixed body. Each connection is served by its own thread.
+ */
+class loopback_http_server {
+	int m_fd;
+	uint16_t m_port;
+	std::string m_response;
+	std::thread m_thread;
+
+	static void serve(int fd, const std::string& response) {
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		std::string buf;
+		char tmp[4096];
+		while (true) {
+			auto n = read(fd, tmp, sizeof(tmp));
+			if (n <= 0) break;
+			buf.append(tmp, n);
+			size_t pos;
+			while ((pos = buf.find("\r\n\r\n")) != std::string::npos) {
+				buf.erase(0, pos + 4);
+				for (size_t off = 0; off < response.size();) {
+					auto written = write(fd, response.data() + off, response.size() - off);
+					if (written <= 0) break;
+					off += written;
+				}
+			}
+		}
+		close(fd);
+	}
+
+public:
+	explicit loopback_http_server(size_t body_size = 16) {
+		m_response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body_size) + "\r\n\r\n" + std::string(body_size, 'x');
+		m_fd = socket(AF_INET, SOCK_STREAM, 0);
+		int one = 1;
+		setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t len = sizeof(addr);
+		if (bind(m_fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || listen(m_fd, 1024) != 0 ||
+			getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+			throw std::runtime_error("failed to create server socket");
+		m_port = ntohs(addr.sin_port);
+		m_thread = std::thread([this]() {
+			while (true) {
+				int client = accept(m_fd, nullptr, nullptr);
+				if (client < 0) break;
+				std::thread(serve, client, std::cref(m_response)).detach();
+			}
+		});
+	}
+	~loopback_http_server() {
+		shutdown(m_fd, SHUT_RDWR);
+		close(m_fd);
+		m_thread.join();
+	}
+	loopback_http_server(const loopback_http_server&) = delete;
+	loopback_http_server& operator=(const loopback_http_server&) = delete;
+
+	std::string url() const { return "http://127.0.0.1:" + std::to_string(m_port) + "/"; }
+};
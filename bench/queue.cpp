@@ -0,0 +1,56 @@
+#include <asyncpp/curl/mpsc_queue.h>
+#include <asyncpp/curl/unique_function.h>
+#include <asyncpp/threadsafe_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Compares push/pop throughput of the executor task queue against asyncpp::threadsafe_queue<std::function>,
+ * using tasks that resemble the completion callbacks pushed by the executor.
+ */
+template<typename Queue, typename Task>
+static double run(size_t num_producers, size_t num_tasks) {
+	Queue queue;
+	std::atomic<bool> start{false};
+	uint64_t sum = 0;
+	std::vector<std::thread> producers;
+	for (size_t p = 0; p < num_producers; p++) {
+		producers.emplace_back([&]() {
+			std::function<void(int)> cb = [&sum](int res) { sum += res; };
+			while (!start.load())
+				std::this_thread::yield();
+			for (size_t i = 0; i < num_tasks; i++)
+				queue.emplace(Task{[cb, res = 1]() { cb(res); }});
+		});
+	}
+	auto begin = std::chrono::steady_clock::now();
+	start = true;
+	for (size_t received = 0; received < num_producers * num_tasks;) {
+		auto fn = queue.pop();
+		if (!fn) continue;
+		(*fn)();
+		received++;
+	}
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	for (auto& t : producers)
+		t.join();
+	if (sum != num_producers * num_tasks) std::printf("invalid result\n");
+	return static_cast<double>(num_producers * num_tasks) / elapsed;
+}
+
+int main(int argc, const char** argv) {
+	const size_t num_tasks = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	std::printf("%-10s %20s %20s\n", "producers", "threadsafe_queue/s", "mpsc_queue/s");
+	for (size_t producers : {1, 2, 4, 8}) {
+		auto old_rate = run<asyncpp::threadsafe_queue<std::function<void()>>, std::function<void()>>(producers, num_tasks / producers);
+		auto new_rate = run<asyncpp::curl::mpsc_queue<asyncpp::curl::unique_function<void()>>, asyncpp::curl::unique_function<void()>>(producers, num_tasks / producers);
+		std::printf("%-10zu %20.0f %20.0f\n", producers, old_rate, new_rate);
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include "loopback_server.h"
+
+#include <asyncpp/curl/handle.h>
+
+#include <chrono>
+#include <cstdio>
+#include <curl/curl.h>
+#include <functional>
+#include <string>
+
+using namespace asyncpp::curl;
+using clock_type = std::chrono::steady_clock;
+
+/*
+ * Measures write callback throughput on a large local transfer. A small receive buffer is used,
+ * so the per chunk cost of invoking the callback is visible next to the cost of moving the data.
+ */
+namespace {
+	template<typename Setter>
+	double run(const std::string& url, size_t count, size_t body_size, Setter&& set_callback) {
+		handle hdl;
+		size_t received = 0;
+		size_t chunks = 0;
+		hdl.set_url(url);
+		hdl.set_option_long(CURLOPT_BUFFERSIZE, 1024);
+		set_callback(hdl, received, chunks);
+		auto start = clock_type::now();
+		for (size_t i = 0; i < count; i++)
+			hdl.perform();
+		auto secs = std::chrono::duration<double>(clock_type::now() - start).count();
+		if (received != count * body_size) std::printf("unexpected amount of data received\n");
+		return received / secs / (1024 * 1024);
+	}
+} // namespace
+
+int main(int argc, const char** argv) {
+	const size_t count = argc > 1 ? std::stoul(argv[1]) : 20;
+	const size_t body_size = 16 * 1024 * 1024;
+	loopback_http_server server{body_size};
+	std::printf("%-15s %12s\n", "callback", "MiB/s");
+	for (size_t round = 0; round < 2; round++) {
+		auto function = run(server.url(), count, body_size, [](handle& hdl, size_t& received, size_t& chunks) {
+			hdl.set_writefunction(std::function<size_t(char*, size_t)>([&received, &chunks](char*, size_t size) {
+				received += size;
+				chunks++;
+				return size;
+			}));
+		});
+		auto templated = run(server.url(), count, body_size, [](handle& hdl, size_t& received, size_t& chunks) {
+			hdl.set_writefunction([&received, &chunks](char*, size_t size) {
+				received += size;
+				chunks++;
+				return size;
+			});
+		});
+		std::printf("%-15s %12.0f\n%-15s %12.0f\n", "std::function", function, "template", templated);
+	}
+	return 0;
+}
@@ -1,11 +1,17 @@
 #pragma once
 #include <asyncpp/curl/base64.h>
 #include <asyncpp/curl/cookie.h>
+#include <asyncpp/curl/epoll_adapter.h>
 #include <asyncpp/curl/exception.h>
 #include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/executor_pool.h>
 #include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/handle_pool.h>
+#include <asyncpp/curl/handle_template.h>
 #include <asyncpp/curl/multi.h>
+#include <asyncpp/curl/rate_limiter.h>
 #include <asyncpp/curl/sha1.h>
+#include <asyncpp/curl/share.h>
 #include <asyncpp/curl/slist.h>
 #include <asyncpp/curl/tcp_client.h>
 #include <asyncpp/curl/uri.h>
@@ -0,0 +1,60 @@
+#pragma once
+#ifdef __linux__
+#include <cstddef>
+#include <cstdint>
+
+namespace asyncpp::curl {
+	class multi;
+	/**
+	 * \brief Drives a multi handle from an external event loop.
+	 *
+	 * The adapter installs the socket and timer callbacks of the multi and tracks all sockets and the curl timeout in an epoll set.
+	 * The epoll fd becomes readable whenever curl needs attention, so it can be added to an existing reactor (epoll, poll, libuv, ...)
+	 * like any other fd. Once it is readable call process(), which hands the ready sockets to curl_multi_socket_action() without blocking.
+	 * Finished transfers can be read using multi::next_event() afterwards.
+	 * \note The adapter is not thread safe, all calls have to be made from the thread running the event loop.
+	 */
+	class epoll_adapter {
+		multi& m_multi;
+		int m_epoll_fd;
+		int m_timer_fd;
+		int m_still_running;
+
+		void update_socket(uint64_t fd, int what);
+		void update_timer(long timeout_ms);
+
+	public:
+		/**
+		 * \brief Attach to a multi handle.
+		 * \param m The multi to drive. Its socket and timer callbacks are replaced and removed again on destruction.
+		 */
+		explicit epoll_adapter(multi& m);
+		~epoll_adapter() noexcept;
+		epoll_adapter(const epoll_adapter&) = delete;
+		epoll_adapter& operator=(const epoll_adapter&) = delete;
+		epoll_adapter(epoll_adapter&&) = delete;
+		epoll_adapter& operator=(epoll_adapter&&) = delete;
+
+		/** \brief Get the epoll fd to monitor for readability in the external event loop */
+		int native_handle() const noexcept { return m_epoll_fd; }
+
+		/**
+		 * \brief Handle all ready sockets and an expired curl timeout without blocking.
+		 * \return The number of sockets and timeouts handed to curl
+		 */
+		size_t process();
+
+		/** \brief Get the number of transfers that are still running as reported by the last call into curl */
+		int still_running() const noexcept { return m_still_running; }
+
+		/**
+		 * \brief Apply a socket callback event of curl to an epoll set.
+		 * \param epoll_fd The epoll set to update, the socket is registered with data.fd set to it
+		 * \param fd The socket passed to the socket callback
+		 * \param what The CURL_POLL_* value passed to the socket callback
+		 * \note This is used by the adapter and the executor, it is public so custom event loops can use it as well.
+		 */
+		static void update_epoll(int epoll_fd, uint64_t fd, int what);
+	};
+} // namespace asyncpp::curl
+#endif
@@ -1,40 +1,283 @@
 #pragma once
+#include <asyncpp/curl/handle_pool.h>
+#include <asyncpp/curl/mpsc_queue.h>
 #include <asyncpp/curl/multi.h>
+#include <asyncpp/curl/timer_wheel.h>
+#include <asyncpp/curl/unique_function.h>
 #include <asyncpp/detail/std_import.h>
 #include <asyncpp/dispatcher.h>
-#include <asyncpp/threadsafe_queue.h>
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <deque>
+#include <exception>
 #include <future>
-#include <map>
+#include <memory>
 #include <mutex>
-#include <set>
+#include <span>
 #include <stop_token>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace asyncpp::curl {
 	class handle;
+	class rate_limiter;
+	class share;
 	/**
 	 * \brief Curl Executor class, implements a dispatcher on top of curl_multi_*.
 	 */
 	class executor : public dispatcher {
+	public:
+		/** \brief Strategy used by the executor thread to drive transfers */
+		enum class loop_mode {
+			/** \brief Use curl_multi_perform() and curl_multi_poll(), which check every transfer on each wakeup. */
+			poll,
+			/**
+			 * \brief Use curl_multi_socket_action() together with an epoll set owned by the executor.
+			 * Each wakeup only touches the sockets that are actually ready. Only supported on linux.
+			 */
+			socket_action,
+		};
+
+		/** \brief Priority lane of a task */
+		enum class task_priority {
+			/** \brief Runs after all urgent tasks and in order with done callbacks, timers and other normal tasks */
+			normal,
+			/** \brief Runs ahead of normal work, e.g. for cancellation or keep alive replies */
+			urgent,
+		};
+
+		/** \brief Options used to construct an executor */
+		struct options {
+			/** \brief The strategy used for driving transfers */
+			loop_mode mode{loop_mode::poll};
+			/**
+			 * \brief Start a thread that drives the executor.
+			 * If false the executor is driven by calling run_once() or run_until() instead,
+			 * which allows using it from within an existing event loop without crossing threads.
+			 * The constructing thread is treated as the executor thread until run_once() is called from a different thread.
+			 */
+			bool start_thread{true};
+			/**
+			 * \brief Keep polling without blocking for this long after the last activity before going to sleep.
+			 * This trades cpu time for lower wakeup latency, e.g. for streams with frequent small messages. Disabled if zero.
+			 */
+			std::chrono::microseconds busy_poll{0};
+			/** \brief CPUs the executor thread is allowed to run on, empty keeps the inherited affinity. Only supported on linux. */
+			std::vector<size_t> cpu_affinity{};
+			/** \brief Name of the executor thread, empty keeps the inherited name. Truncated to 15 characters and ignored on platforms other than linux. */
+			std::string thread_name{};
+			/** \brief Realtime (SCHED_FIFO) priority of the executor thread, 0 keeps the default scheduling policy. Only supported on linux. */
+			int priority{0};
+			/** \brief Maximum number of urgent tasks run back to back before the next normal task gets a turn */
+			size_t urgent_burst{16};
+			/**
+			 * \brief Share handle attached to every handle added to the executor that has no share of its own.
+			 * Using the same share for multiple executors (e.g. all executors of a pool) lets them use a common DNS and TLS session cache.
+			 */
+			std::shared_ptr<curl::share> share_handle{};
+			/** \brief Multiplex transfers to the same host over a single HTTP/2 connection (CURLMOPT_PIPELINING) */
+			bool multiplex{true};
+			/** \brief Maximum number of connections to a single host, 0 means unlimited (CURLMOPT_MAX_HOST_CONNECTIONS) */
+			size_t max_host_connections{0};
+			/** \brief Maximum number of open connections, 0 means unlimited (CURLMOPT_MAX_TOTAL_CONNECTIONS) */
+			size_t max_total_connections{0};
+			/** \brief Size of the connection cache, 0 keeps the default of growing with the number of transfers (CURLMOPT_MAXCONNECTS) */
+			size_t max_connects{0};
+			/** \brief Maximum number of concurrent streams per HTTP/2 connection, 0 keeps the curl default (CURLMOPT_MAX_CONCURRENT_STREAMS) */
+			size_t max_concurrent_streams{0};
+			/**
+			 * \brief Maximum number of transfers to the same host running at the same time, 0 means unlimited.
+			 * Additional transfers wait in a FIFO queue per host until a running one finishes, so a slow host can not take up all connections.
+			 * The time spent waiting is available using handle::get_queue_time().
+			 */
+			size_t max_host_transfers{0};
+			/** \brief Rate limit applied to all transfers of the executor, waiting transfers are started once a token is available */
+			std::shared_ptr<rate_limiter> rate_limit{};
+			/**
+			 * \brief Rate limits applied to transfers to a specific host, in addition to rate_limit.
+			 * The key is the host (and port if present in the url) in lower case, e.g. "example.com" or "127.0.0.1:8080".
+			 */
+			std::unordered_map<std::string, std::shared_ptr<rate_limiter>> host_rate_limits{};
+		};
+
+		/** \brief Snapshot of the executor statistics */
+		struct statistics {
+			/** \brief Number of buckets in the task delay histogram */
+			static constexpr size_t task_delay_buckets = 16;
+
+			/** \brief Number of loop iterations of the executor thread */
+			uint64_t loop_iterations{0};
+			/** \brief Time spent in curl_multi_perform() and reading finished transfers */
+			std::chrono::nanoseconds perform_time{0};
+			/** \brief Time spent waiting for activity, including socket event processing in socket_action mode */
+			std::chrono::nanoseconds wait_time{0};
+			/** \brief Time spent running pushed tasks and callbacks of finished transfers and connect_only handles */
+			std::chrono::nanoseconds task_time{0};
+			/** \brief Time spent running scheduled invocables */
+			std::chrono::nanoseconds timer_time{0};
+			/** \brief Highest number of tasks waiting in the queue at the start of a loop iteration */
+			size_t queue_high_water{0};
+			/** \brief Number of transfers currently added to the executor */
+			size_t running_transfers{0};
+			/** \brief Number of connect_only handles currently added to the executor */
+			size_t connect_only_handles{0};
+			/** \brief Number of transfers waiting for a free slot of their host, see options::max_host_transfers */
+			size_t queued_transfers{0};
+			/** \brief Number of times another thread had to wake the executor thread */
+			size_t wakeups{0};
+			/** \brief Number of wakeups that were saved by coalescing */
+			size_t coalesced_wakeups{0};
+			/**
+			 * \brief Histogram of the time between pushing a task and it starting to run.
+			 * Bucket 0 counts delays below 1us, bucket i delays in [2^(i-1), 2^i) us and the last bucket all longer delays.
+			 */
+			std::array<uint64_t, task_delay_buckets> task_delay{};
+		};
+
+		/** \brief Result of draining the executor */
+		struct drain_result {
+			/** \brief Number of transfers that finished on their own while draining */
+			size_t finished{0};
+			/** \brief Number of transfers that were still running at the deadline and got aborted */
+			size_t aborted{0};
+		};
+
+	private:
+		struct queued_task {
+			unique_function<void()> fn{};
+			std::chrono::steady_clock::time_point queued{};
+		};
+		// Statistics are accumulated by the executor thread and published once per loop iteration
+		struct published_statistics {
+			std::atomic<uint64_t> loop_iterations{0};
+			std::atomic<int64_t> perform_time{0};
+			std::atomic<int64_t> wait_time{0};
+			std::atomic<int64_t> task_time{0};
+			std::atomic<int64_t> timer_time{0};
+			std::atomic<size_t> queue_high_water{0};
+			std::atomic<size_t> connect_only_handles{0};
+			std::atomic<size_t> queued_transfers{0};
+			std::array<std::atomic<uint64_t>, statistics::task_delay_buckets> task_delay{};
+		};
+
+		const options m_options;
 		multi m_multi;
 		std::thread m_thread;
+		// Thread currently driving the executor, either m_thread or the constructing thread / last caller of run_once()
+		std::atomic<std::thread::id> m_thread_id;
+		// Always locked before a handle mutex, never while holding one
 		std::mutex m_mtx;
 		std::atomic<bool> m_exit;
-		threadsafe_queue<std::function<void()>> m_queue;
-		std::multimap<std::chrono::steady_clock::time_point, std::function<void()>> m_scheduled;
-		std::set<handle*> m_connect_only_handles;
+		std::atomic<bool> m_draining;
+		mpsc_queue<queued_task> m_queue;
+		mpsc_queue<queued_task> m_urgent_queue;
+		timer_wheel m_scheduled;
+		handle_pool m_handle_pool;
+		// Registry of connect_only handles, only modified on the executor thread
+		struct connect_only_state {
+			uint64_t fd;
+			int events;
+			size_t index; // Index in m_poll_fds in poll mode
+		};
+		std::unordered_map<handle*, connect_only_state> m_connect_only;
+		// Transfers currently added to the multi, only modified on the executor thread
+		std::unordered_set<handle*> m_transfers;
+		// Per host admission state if options::max_host_transfers is set, only accessed on the executor thread
+		struct host_state {
+			size_t running{0};
+			std::deque<handle*> waiting{};
+		};
+		std::unordered_map<std::string, host_state> m_hosts;
+		size_t m_queued_transfers{0};
+		// Transfers waiting for a rate limit, only accessed on the executor thread
+		struct delayed_transfer {
+			timer_wheel::timer_id timer;
+			uint64_t sequence;
+		};
+		std::unordered_map<handle*, delayed_transfer> m_delayed;
+		uint64_t m_delay_sequence{0};
+		// State of a running drain(), only accessed on the executor thread
+		struct drain_state {
+			std::promise<drain_result> promise;
+			timer_wheel::timer_id timer{};
+			drain_result result{};
+		};
+		std::unique_ptr<drain_state> m_drain;
+		std::vector<curl_waitfd> m_poll_fds;
+		std::vector<handle*> m_poll_handles;
+		std::vector<std::pair<handle*, int>> m_ready;
+		// connect_only handles paused or unpaused from other threads
+		std::mutex m_changed_mtx;
+		std::vector<handle*> m_changed;
+		// Scratch buffers reused by every loop iteration
+		std::vector<handle*> m_changed_local;
+		std::vector<std::function<void()>> m_expired;
+		std::vector<std::pair<std::function<void(int)>, int>> m_completed;
+		std::atomic<size_t> m_num_handles;
+		// Wakeup coalescing, only the first notify() while the loop is about to sleep signals it
+		std::atomic<bool> m_sleeping;
+		std::atomic<bool> m_wakeup_pending;
+		std::atomic<size_t> m_wakeups_sent;
+		std::atomic<size_t> m_wakeups_coalesced;
+		// State of the socket_action loop mode
+		int m_epoll_fd;
+		int m_wakeup_fd;
+		int m_still_running;
+		// timerfd used to wake the executor at the next timer deadline
+		int m_timer_fd;
+		std::chrono::steady_clock::time_point m_timer_armed;
+		std::chrono::steady_clock::time_point m_socket_timeout;
+		// Last time the loop did any work, used for busy polling
+		std::chrono::steady_clock::time_point m_last_activity;
+		statistics m_stats;
+		published_statistics m_published_stats;
 
 		void worker_thread() noexcept;
+		void close_fds() noexcept;
+		bool loop_once(int max_wait_ms);
+		bool is_executor_thread() const noexcept { return m_thread_id.load(std::memory_order_relaxed) == std::this_thread::get_id(); }
+		void perform(int* still_running);
+		long transfer_timeout();
+		bool wait(int timeout_ms);
+		void notify();
+		void publish_stats() noexcept;
+		void signal();
+		void run_task(queued_task& task);
+		size_t run_urgent();
+		void run_timers(std::vector<std::function<void()>>& expired);
+		long timer_timeout();
+		void add_handle_impl(handle& hdl);
+		void remove_handle_impl(handle& hdl);
+		void add_transfer(handle& hdl);
+		void remove_transfer(handle& hdl);
+		void start_transfer(handle& hdl, bool delayed);
+		void admit_transfers(const std::string& host_name);
+		void fail_transfer(handle& hdl);
+		void release_rate_limits(const handle& hdl);
+		void check_drain();
+		void abort_transfers();
+		void connect_only_changed(handle& hdl);
+		void update_connect_only(handle& hdl);
+		void unregister_connect_only(connect_only_state& state);
+		void dispatch_connect_only();
+
+		friend class handle;
 
 	public:
 		/**
 		 * \brief Construct a new executor object
 		 */
 		executor();
+		/**
+		 * \brief Construct a new executor object
+		 * \param opts Options to use for the executor
+		 */
+		explicit executor(const options& opts);
 		/**
 		 * \brief Destroy the executor object
 		 */
@@ -56,6 +299,99 @@ namespace asyncpp::curl {
 		 * \param hdl The handle to remove
 		 */
 		void remove_handle(handle& hdl);
+		/**
+		 * \brief Add an easy handle to this executor without waiting for it to get added.
+		 * \param hdl The handle to add
+		 * \note If adding the handle fails, its done callback is invoked with CURLE_FAILED_INIT.
+		 */
+		void add_handle_nowait(handle& hdl);
+		/**
+		 * \brief Remove an easy handle from this executor without waiting for it to get removed.
+		 * \param hdl The handle to remove
+		 * \note The handle has to stay alive till it is removed, use remove_handle_async() if you need to know when that happened.
+		 */
+		void remove_handle_nowait(handle& hdl);
+
+		/** \brief coroutine awaiter for adding or removing a handle */
+		struct handle_awaiter {
+			executor* const m_parent;
+			handle* const m_handle;
+			void (executor::*const m_operation)(handle&);
+			std::exception_ptr m_error{};
+
+			bool await_ready();
+			void await_suspend(coroutine_handle<> h);
+			void await_resume() const {
+				if (m_error) std::rethrow_exception(m_error);
+			}
+		};
+
+		/**
+		 * \brief Return an awaitable that adds the handle to this executor without blocking the calling thread.
+		 * \param hdl The handle to add
+		 * \return An awaitable
+		 * \note Unless already running on it, the coroutine is resumed on the executor thread.
+		 */
+		handle_awaiter add_handle_async(handle& hdl) { return handle_awaiter{this, &hdl, &executor::add_handle_impl}; }
+		/**
+		 * \brief Return an awaitable that removes the handle from this executor without blocking the calling thread.
+		 * \param hdl The handle to remove
+		 * \return An awaitable
+		 * \note Unless already running on it, the coroutine is resumed on the executor thread.
+		 */
+		handle_awaiter remove_handle_async(handle& hdl) { return handle_awaiter{this, &hdl, &executor::remove_handle_impl}; }
+
+		/**
+		 * \brief Get the number of handles currently managed by this executor.
+		 * \return The number of running transfers and connect_only handles
+		 * \note The value is only a snapshot and might be outdated by the time it is returned.
+		 */
+		size_t num_handles() const noexcept { return m_num_handles.load(std::memory_order_relaxed); }
+		/**
+		 * \brief Get the number of times another thread had to wake the executor thread.
+		 */
+		size_t num_wakeups() const noexcept { return m_wakeups_sent.load(std::memory_order_relaxed); }
+		/**
+		 * \brief Get the number of wakeups that were saved because the executor was busy or already about to wake up.
+		 */
+		size_t num_coalesced_wakeups() const noexcept { return m_wakeups_coalesced.load(std::memory_order_relaxed); }
+		/**
+		 * \brief Finish all transfers, aborting the ones still running at the deadline.
+		 *
+		 * New transfers are rejected from the moment this is called, see below. Running transfers can finish until the deadline,
+		 * the remaining ones are removed and their done callbacks are invoked with CURLE_ABORTED_BY_CALLBACK.
+		 * connect_only handles are not affected.
+		 * \param deadline Time until which transfers are allowed to finish
+		 * \return The number of finished and aborted transfers
+		 * \note Blocks until the drain is complete. Without a thread the calling thread drives the executor meanwhile.
+		 * \note Draining is terminal: afterwards all transfers except connect_only handles are rejected with CURLE_FAILED_INIT
+		 *       for the lifetime of the executor and calling drain() again throws std::logic_error. Tasks and timers keep working.
+		 */
+		drain_result drain(std::chrono::steady_clock::time_point deadline);
+		/**
+		 * \brief Run a single iteration of the executor loop on the calling thread.
+		 *
+		 * Performs transfers, invokes the callbacks of finished transfers, expired timers and queued tasks.
+		 * If there was nothing to do it waits for new activity and handles it before returning.
+		 * \param timeout Maximum time to wait for new activity, a negative value waits until something happens
+		 * \return false if the executor is being destroyed and has no transfers left, true otherwise
+		 * \note Only valid if the executor was constructed with options::start_thread set to false.
+		 * \note Must not be called concurrently or from within a callback. The calling thread is treated as the executor thread afterwards.
+		 */
+		bool run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds{0});
+		/**
+		 * \brief Run the executor loop on the calling thread until a stop is requested.
+		 * \param st Stop token to end the loop
+		 * \note The same restrictions as for run_once() apply.
+		 */
+		void run_until(std::stop_token st);
+		/** \brief Get the pool of easy handles used for requests run on this executor */
+		handle_pool& handles() noexcept { return m_handle_pool; }
+		/**
+		 * \brief Get a snapshot of the executor statistics.
+		 * \note The values are published by the executor thread once per loop iteration and are not updated atomically as a whole.
+		 */
+		statistics stats() const noexcept;
 
 		/** \brief coroutine awaiter for an easy transfer */
 		struct exec_awaiter {
@@ -89,18 +425,79 @@ namespace asyncpp::curl {
 		 * \param fn Invocable to call
 		 */
 		void push(std::function<void()> fn) override;
+		/**
+		 * \brief Push a invocable to be executed on the executor thread.
+		 * \param fn Invocable to call
+		 * \param prio The priority lane to use
+		 * \note Urgent tasks run before pending done callbacks, timers and normal tasks,
+		 *       but at most options::urgent_burst of them run between two normal items.
+		 */
+		void push(std::function<void()> fn, task_priority prio);
+		/** \brief Handle to a scheduled invocable, which allows cancelling it before it runs. */
+		class timer_handle {
+			executor* m_parent{nullptr};
+			timer_wheel::timer_id m_id{};
+
+			friend class executor;
+			timer_handle(executor* parent, timer_wheel::timer_id id) noexcept : m_parent(parent), m_id(id) {}
+
+		public:
+			timer_handle() noexcept = default;
+			/**
+			 * \brief Cancel the scheduled invocable.
+			 * \return true if the invocable was cancelled, false if it already ran (or is running) or the handle is empty
+			 */
+			bool cancel();
+			/** \brief Check if this handle refers to a scheduled invocable */
+			bool valid() const noexcept { return m_parent != nullptr; }
+		};
+
 		/**
 		 * \brief Schedule an invocable in a certain time from now.
 		 * \param fn Invocable to execute on the executor thread
 		 * \param timeout Timeout to execute the invocable at
+		 * \param prio The priority lane to run the invocable in once it expired
+		 * \return A handle that can be used to cancel the invocable
 		 */
-		void schedule(std::function<void()> fn, std::chrono::milliseconds timeout);
+		timer_handle schedule(std::function<void()> fn, std::chrono::milliseconds timeout, task_priority prio = task_priority::normal);
 		/**
 		 * \brief Schedule an invocable at a certain timepoint.
 		 * \param fn Invocable to execute on the executor thread
 		 * \param time Timestamp at which to execute the invocable
+		 * \param prio The priority lane to run the invocable in once it expired
+		 * \return A handle that can be used to cancel the invocable
+		 * \note The invocable is never executed before the given timestamp.
+		 */
+		timer_handle schedule(std::function<void()> fn, std::chrono::steady_clock::time_point time, task_priority prio = task_priority::normal);
+
+		/** \brief coroutine awaiter for a point in time */
+		struct sleep_awaiter {
+			executor* const m_parent;
+			const std::chrono::steady_clock::time_point m_deadline;
+
+			bool await_ready() const noexcept { return m_deadline <= std::chrono::steady_clock::now(); }
+			void await_suspend(coroutine_handle<> h) {
+				m_parent->schedule([h]() { h.resume(); }, m_deadline);
+			}
+			constexpr void await_resume() const noexcept {}
+		};
+
+		/**
+		 * \brief Return an awaitable that suspends till the given point in time.
+		 * \param time Timestamp to resume at
+		 * \return An awaitable
+		 * \note The coroutine is resumed on the executor thread.
 		 */
-		void schedule(std::function<void()> fn, std::chrono::steady_clock::time_point time);
+		sleep_awaiter sleep_until(std::chrono::steady_clock::time_point time) noexcept { return sleep_awaiter{this, time}; }
+		/**
+		 * \brief Return an awaitable that suspends for the given duration.
+		 * \param duration Time to suspend for
+		 * \return An awaitable
+		 * \note The coroutine is resumed on the executor thread.
+		 */
+		sleep_awaiter sleep_for(std::chrono::nanoseconds duration) noexcept {
+			return sleep_awaiter{this, std::chrono::steady_clock::now() + duration};
+		}
 
 		/**
 		 * \brief Run an invocable on the executor thread and return the result.
@@ -108,7 +505,7 @@ namespace asyncpp::curl {
 		 */
 		template<typename FN>
 		std::invoke_result_t<FN> push_wait(FN&& fn) {
-			if (m_thread.get_id() == std::this_thread::get_id()) {
+			if (this->is_executor_thread()) {
 				return fn();
 			} else {
 				std::promise<std::invoke_result_t<FN>> promise;
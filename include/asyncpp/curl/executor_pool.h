@@ -0,0 +1,84 @@
+#pragma once
+#include <asyncpp/curl/executor.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace asyncpp::curl {
+	/**
+	 * \brief A fixed set of executors, each running on its own thread.
+	 *
+	 * Spreads transfers and connections across multiple executors based on a placement policy,
+	 * allowing throughput to scale with the number of cores.
+	 */
+	class executor_pool {
+	public:
+		/** \brief Policy used to select an executor for new work */
+		enum class placement {
+			/** \brief Cycle through all executors in order */
+			round_robin,
+			/** \brief Use the executor with the smallest number of handles */
+			least_loaded,
+			/** \brief Use a hash of the remote host, so all transfers to the same host share an executor (and its connection cache) */
+			host_hash,
+		};
+
+		/** \brief Options used to construct an executor pool */
+		struct options {
+			/** \brief Number of executors to create, 0 uses the number of hardware threads */
+			size_t size{0};
+			/** \brief The placement policy used by get() */
+			placement policy{placement::round_robin};
+			/**
+			 * \brief Options passed to each executor. If a thread name is set, the index of the executor is appended to it.
+			 * A share_handle is used by all executors, so DNS lookups and TLS sessions are shared across the pool.
+			 */
+			executor::options executor_options{};
+			/**
+			 * \brief Pin each executor to its own cpu, wrapping around if there are more executors than usable cpus.
+			 * Overrides executor_options.cpu_affinity. Only supported on linux.
+			 */
+			bool pin_threads{false};
+		};
+
+		/** \brief Construct a pool with one executor per hardware thread */
+		executor_pool();
+		/**
+		 * \brief Construct a pool
+		 * \param opts Options to use for the pool
+		 */
+		explicit executor_pool(const options& opts);
+		~executor_pool() noexcept;
+		executor_pool(const executor_pool&) = delete;
+		executor_pool& operator=(const executor_pool&) = delete;
+		executor_pool(executor_pool&&) = delete;
+		executor_pool& operator=(executor_pool&&) = delete;
+
+		/** \brief Get the number of executors in this pool */
+		size_t size() const noexcept { return m_executors.size(); }
+		/** \brief Get the executor at the given index */
+		executor& operator[](size_t idx) const noexcept { return *m_executors[idx]; }
+
+		/**
+		 * \brief Select an executor for new work using the placement policy.
+		 * \param host The remote host the work is for. If empty host_hash falls back to round_robin.
+		 * \return The selected executor
+		 */
+		executor& get(std::string_view host = {}) noexcept;
+
+		/**
+		 * \brief Get a global default executor pool
+		 * \return A global executor pool instance
+		 * \note Do not keep references to this pool past the end of main because the destruction order is not predictable.
+		 */
+		static executor_pool& get_default();
+
+	private:
+		const placement m_policy;
+		std::vector<std::unique_ptr<executor>> m_executors;
+		std::atomic<size_t> m_next;
+	};
+} // namespace asyncpp::curl
@@ -1,15 +1,94 @@
 #pragma once
+#include <asyncpp/curl/unique_function.h>
+
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 
 namespace asyncpp::curl {
 	class multi;
 	class executor;
+	class share;
 	class slist;
+
+	/** \brief Kind of value a curl option takes, derived from the option id like curl does using CURLOPTTYPE_* */
+	enum class option_kind {
+		/** \brief long (CURLOPTTYPE_LONG) */
+		long_value,
+		/** \brief String, slist or object pointer (CURLOPTTYPE_OBJECTPOINT) */
+		pointer,
+		/** \brief Function pointer (CURLOPTTYPE_FUNCTIONPOINT) */
+		function,
+		/** \brief curl_off_t (CURLOPTTYPE_OFF_T) */
+		offset,
+		/** \brief struct curl_blob (CURLOPTTYPE_BLOB) */
+		blob,
+		/** \brief Not a valid option id */
+		invalid,
+	};
+
+	/** \brief Kind of pointer a CURLOPTTYPE_OBJECTPOINT option takes */
+	enum class pointer_kind {
+		/** \brief Not a pointer option */
+		none,
+		/** \brief Zero terminated string, copied by curl */
+		string,
+		/** \brief Memory curl keeps using after the call (CURLOPT_ERRORBUFFER and CURLOPT_POSTFIELDS) */
+		buffer,
+		/** \brief curl_slist (CURLOPTTYPE_SLISTPOINT) */
+		slist,
+		/** \brief Any other object, e.g. callback data, FILE* or CURLSH* */
+		object,
+	};
+
+	namespace detail {
+		// Ids of the pointer options that do not take a string, checked against curl.h in handle.cpp
+		constexpr int opt_errorbuffer = 10010;
+		constexpr int opt_postfields = 10015;
+		constexpr int slist_options[] = {10023, 10028, 10039, 10070, 10093, 10104, 10187, 10203, 10228, 10243};
+		constexpr int object_options[] = {10001, 10009, 10024, 10029, 10037, 10057, 10095, 10100, 10103, 10109, 10131, 10149, 10164, 10168, 10185,
+										  10195, 10201, 10202, 10209, 10240, 10241, 10269, 10273, 10282, 10284, 10302, 10304, 10313, 10317};
+
+		template<size_t N>
+		constexpr bool contains(const int (&list)[N], int opt) noexcept {
+			for (auto e : list)
+				if (e == opt) return true;
+			return false;
+		}
+	} // namespace detail
+
+	/** \brief Compile time information about a curl option */
+	template<int Opt>
+	struct option_traits {
+		static constexpr option_kind kind = []() {
+			switch (Opt / 10000) {
+			case 0: return option_kind::long_value;
+			case 1: return option_kind::pointer;
+			case 2: return option_kind::function;
+			case 3: return option_kind::offset;
+			case 4: return option_kind::blob;
+			default: return option_kind::invalid;
+			}
+		}();
+		/** \brief Kind of pointer a pointer option takes, every pointer option not known to take something else is a string */
+		static constexpr pointer_kind pointer = []() {
+			if (kind != option_kind::pointer) return pointer_kind::none;
+			if (Opt == detail::opt_errorbuffer || Opt == detail::opt_postfields) return pointer_kind::buffer;
+			if (detail::contains(detail::slist_options, Opt)) return pointer_kind::slist;
+			if (detail::contains(detail::object_options, Opt)) return pointer_kind::object;
+			return pointer_kind::string;
+		}();
+		/** \brief True if the option takes a string curl copies, false for buffers it keeps using (e.g. CURLOPT_POSTFIELDS) and non string options */
+		static constexpr bool copies_string = pointer == pointer_kind::string;
+	};
 	/**
 	 * \brief Wrapper around a libcurl handle.
 	 * 
@@ -20,16 +99,53 @@ namespace asyncpp::curl {
 		void* m_instance;
 		multi* m_multi;
 		executor* m_executor;
+		// Executor whose thread exclusively uses this handle, no locking is done while set.
+		// m_owner_thread is the thread that was driving it when set_owner() was called and only changes together with m_owner.
+		std::atomic<executor*> m_owner;
+		std::thread::id m_owner_thread;
 		std::function<void(int result)> m_done_callback{};
 		std::function<size_t(char* buffer, size_t size)> m_header_callback{};
 		std::function<size_t(int64_t dltotal, int64_t dlnow, int64_t ultotal, int64_t ulnow)> m_progress_callback{};
-		std::function<size_t(char* buffer, size_t size)> m_read_callback{};
-		std::function<size_t(char* buffer, size_t size)> m_write_callback{};
+		unique_function<size_t(char* buffer, size_t size)> m_read_callback{};
+		unique_function<size_t(char* buffer, size_t size)> m_write_callback{};
 		std::map<int, slist> m_owned_slists;
+		std::shared_ptr<share> m_share;
+		// Host of the current url, used by the executor for per host limits
+		std::string m_host;
+		std::chrono::steady_clock::time_point m_queued;
+		std::chrono::nanoseconds m_queue_time;
 		uint32_t m_flags;
 
 		friend class multi;
 		friend class executor;
+		friend class handle_pool;
+
+		// Locks m_mtx unless the handle is owned by an executor, defined in handle.cpp
+		class access_guard;
+		// Check used by debug builds to make sure an owned handle is not accessed from a foreign thread
+		bool is_owner_thread() const noexcept { return m_owner_thread == std::this_thread::get_id(); }
+		// Drop the owner binding without the thread check, used by handle_pool once the last user gave the handle back
+		void clear_owner() noexcept;
+
+		// Wrap an existing curl easy handle, used by duplicate()
+		explicit handle(void* instance);
+
+		// Signature of curl_write_callback and curl_read_callback
+		using data_callback = size_t (*)(char* buffer, size_t size, size_t nitems, void* udata);
+		// Values of CURL_WRITEFUNC_PAUSE, CURL_READFUNC_PAUSE, CURLPAUSE_RECV and CURLPAUSE_SEND, checked in handle.cpp
+		static constexpr size_t func_pause = 0x10000001;
+		static constexpr uint32_t pause_recv = 1 << 0;
+		static constexpr uint32_t pause_send = 1 << 2;
+
+		// Setters without runtime validation of the option type, used by set<>() and the typed helpers
+		void set_long_unchecked(int opt, long val);
+		void set_offset_unchecked(int opt, int64_t val);
+		void set_ptr_unchecked(int opt, const void* ptr);
+		void set_slist_unchecked(int opt, slist list);
+		void clear_slist_unchecked(int opt);
+
+		void set_write_callback(unique_function<size_t(char* buffer, size_t size)> cb, data_callback trampoline);
+		void set_read_callback(unique_function<size_t(char* buffer, size_t size)> cb, data_callback trampoline);
 
 	public:
 		/** \brief Construct a new libcurl handle */
@@ -92,6 +208,54 @@ namespace asyncpp::curl {
 		 */
 		void set_option_slist(int opt, slist list);
 
+		/**
+		 * \brief Set an option, with the value type checked at compile time.
+		 *
+		 * Long options accept integers, enums and bools, offset options accept integers and pointer options accept
+		 * strings (const char* or std::string), slists and object pointers. Function and blob options have to use
+		 * the dedicated setters (e.g. set_writefunction() or set_option_blob()).
+		 * The value has to match option_traits<Opt>::pointer, e.g. CURLOPT_HTTPHEADER only takes an slist and CURLOPT_PRIVATE no string.
+		 * std::string is only accepted for options curl copies the string of, use CURLOPT_COPYPOSTFIELDS instead of CURLOPT_POSTFIELDS.
+		 * \tparam Opt Curl option to set, e.g. CURLOPT_TIMEOUT_MS
+		 * \param val Value to use for option
+		 * \note Unlike the set_option_* functions this does not validate the option at runtime.
+		 */
+		template<int Opt, typename T>
+		void set(T&& val) {
+			using type = std::decay_t<T>;
+			constexpr auto kind = option_traits<Opt>::kind;
+			static_assert(kind != option_kind::invalid, "invalid curl option");
+			static_assert(kind != option_kind::function && kind != option_kind::blob, "function and blob options need to use their dedicated setters");
+			if constexpr (kind == option_kind::long_value) {
+				static_assert(std::is_integral_v<type> || std::is_enum_v<type>, "option requires an integer value");
+				set_long_unchecked(Opt, static_cast<long>(val));
+			} else if constexpr (kind == option_kind::offset) {
+				static_assert(std::is_integral_v<type>, "option requires an integer value");
+				set_offset_unchecked(Opt, static_cast<int64_t>(val));
+			} else if constexpr (kind == option_kind::pointer) {
+				constexpr auto ptr_kind = option_traits<Opt>::pointer;
+				if constexpr (std::is_same_v<type, slist>) {
+					static_assert(ptr_kind == pointer_kind::slist, "option does not take an slist");
+					set_slist_unchecked(Opt, std::forward<T>(val));
+				} else if constexpr (std::is_same_v<type, std::string>) {
+					static_assert(ptr_kind != pointer_kind::buffer, "option keeps using the pointer, std::string would dangle");
+					static_assert(ptr_kind == pointer_kind::string || ptr_kind == pointer_kind::buffer, "option does not take a string");
+					set_ptr_unchecked(Opt, val.c_str());
+				} else if constexpr (std::is_null_pointer_v<type>) {
+					if constexpr (ptr_kind == pointer_kind::slist)
+						clear_slist_unchecked(Opt);
+					else
+						set_ptr_unchecked(Opt, nullptr);
+				} else {
+					static_assert(std::is_pointer_v<type> && !std::is_function_v<std::remove_pointer_t<type>>, "option requires a string, slist or pointer value");
+					static_assert(ptr_kind != pointer_kind::slist, "option requires an slist");
+					static_assert(ptr_kind != pointer_kind::string || std::is_same_v<std::remove_cv_t<std::remove_pointer_t<type>>, char>,
+								  "option requires a string");
+					set_ptr_unchecked(Opt, val);
+				}
+			}
+		}
+
 		/**
 		 * \brief Set the handle url
 		 * \param url The handle url
@@ -127,6 +291,25 @@ namespace asyncpp::curl {
 		 * \note If the handle uses CURLOPT_CONNECT_ONLY and passed to a executor instance this function gets invoked with nullptr when the socket is readable.
 		 */
 		void set_writefunction(std::function<size_t(char* ptr, size_t size)> cb);
+		/**
+		 * \brief Set a function to be called by curl if data is received
+		 * \param cb Callback to be called, see the std::function overload for details
+		 * \throw std::invalid_argument if cb is a null function pointer
+		 * \note Unlike the std::function overload, curl calls a trampoline specific to the callback type, which invokes it without
+		 *	an indirect call. Callbacks up to unique_function::inline_size bytes are stored without allocating.
+		 */
+		template<typename FN>
+		requires(std::is_invocable_r_v<size_t, std::decay_t<FN>&, char*, size_t> && !std::is_same_v<std::decay_t<FN>, std::function<size_t(char*, size_t)>>)
+		void set_writefunction(FN&& cb) {
+			using fn_type = std::decay_t<FN>;
+			constexpr data_callback trampoline = [](char* buffer, size_t size, size_t nmemb, void* udata) -> size_t {
+				auto self = static_cast<handle*>(udata);
+				size_t res = (*self->m_write_callback.template target<fn_type>())(buffer, size * nmemb);
+				if (res == func_pause) self->m_flags |= pause_recv;
+				return res;
+			};
+			set_write_callback(unique_function<size_t(char*, size_t)>{std::forward<FN>(cb)}, trampoline);
+		}
 		/**
 		 * \brief Set a stream to write received data to. This removes any set writefunction.
 		 * \param stream Output stream used for writing.
@@ -149,6 +332,24 @@ namespace asyncpp::curl {
 		 * \note If the handle uses CURLOPT_CONNECT_ONLY and passed to a executor instance this function gets invoked with nullptr when the socket is writable.
 		 */
 		void set_readfunction(std::function<size_t(char* ptr, size_t size)> cb);
+		/**
+		 * \brief Set a function to be called by curl if data is sent to the remote
+		 * \param cb Callback to be called, see the std::function overload for details
+		 * \throw std::invalid_argument if cb is a null function pointer
+		 * \note Like the templated set_writefunction(), this invokes the callback without an indirect call.
+		 */
+		template<typename FN>
+		requires(std::is_invocable_r_v<size_t, std::decay_t<FN>&, char*, size_t> && !std::is_same_v<std::decay_t<FN>, std::function<size_t(char*, size_t)>>)
+		void set_readfunction(FN&& cb) {
+			using fn_type = std::decay_t<FN>;
+			constexpr data_callback trampoline = [](char* buffer, size_t size, size_t nmemb, void* udata) -> size_t {
+				auto self = static_cast<handle*>(udata);
+				size_t res = (*self->m_read_callback.template target<fn_type>())(buffer, size * nmemb);
+				if (res == func_pause) self->m_flags |= pause_send;
+				return res;
+			};
+			set_read_callback(unique_function<size_t(char*, size_t)>{std::forward<FN>(cb)}, trampoline);
+		}
 		/**
 		 * \brief Set a stream to read transmitted data from. This removes any set readfunction.
 		 * \param stream Input stream used for reading.
@@ -199,6 +400,38 @@ namespace asyncpp::curl {
 		 * \note If the handle has an ongoing multi transfer, it is stopped and removed from the multi handle.
 		 */
 		void reset();
+		/**
+		 * \brief Create a copy of this handle using curl_easy_duphandle().
+		 *
+		 * All options are copied. The header and progress callbacks, owned slists and the share are re-bound to the copy.
+		 * \note The read and write callbacks are move only and not copied, the copy uses the libcurl defaults for them.
+		 * \note The done callback belongs to the transfer of this handle and is not copied either.
+		 * \note The copy is not added to any multi or executor and not bound to an owner.
+		 */
+		std::unique_ptr<handle> duplicate() const;
+
+		/**
+		 * \brief Attach a share handle, sharing its caches with all other handles using it.
+		 * \param shared The share to use, nullptr detaches the current one
+		 * \note This must not be called while the handle is performing a transfer.
+		 */
+		void set_share(std::shared_ptr<share> shared);
+		/** \brief Get the share handle attached to this handle or nullptr */
+		const std::shared_ptr<share>& get_share() const noexcept { return m_share; }
+
+		/**
+		 * \brief Bind the handle to the thread of an executor.
+		 *
+		 * While bound, setters, getters, pause, send and recv skip the handle mutex. Only use this if the handle is exclusively
+		 * used from the executor thread (e.g. from done callbacks and tasks pushed to it), starting with this call and up to
+		 * unbinding it again. Debug builds assert this on every access.
+		 * \param owner The executor to bind to, nullptr switches back to locking
+		 * \throw std::logic_error if not called on the thread currently driving owner or, when unbinding, the bound thread
+		 * \note This is cleared by reset(). An executor without a thread has to be driven by the same thread while the handle is bound.
+		 */
+		void set_owner(executor* owner);
+		/** \brief Get the executor this handle is bound to or nullptr */
+		executor* get_owner() const noexcept { return m_owner.load(std::memory_order_relaxed); }
 
 		/**
 		 * \brief Perform connection upkeep work (keep alives) if supported.
@@ -232,6 +465,11 @@ namespace asyncpp::curl {
 		 * \brief Check if this handle has the CURLOPT_VERBOSE option set.
 		 */
 		bool is_verbose() const noexcept;
+		/**
+		 * \brief Get the time the last transfer waited in the executor for a rate limit or a free per host slot before it was started.
+		 * \note Always zero if the executor has no rate limits and does not limit transfers per host.
+		 */
+		std::chrono::nanoseconds get_queue_time() const noexcept;
 
 		/**
 		 * \brief Pause the transfer.
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace asyncpp::curl {
+	class handle;
+	/**
+	 * \brief Pool of reusable easy handles.
+	 *
+	 * Released handles are reset using curl_easy_reset() and kept for the next acquire(), which saves the cost of
+	 * curl_easy_init()/curl_easy_cleanup(). Handles used with perform() also keep their own DNS and TLS session caches,
+	 * handles added to a multi (e.g. by an executor) use the caches of the multi instead.
+	 * Cookies are cleared and a binding to an executor thread (see handle::set_owner()) is dropped on release,
+	 * so neither leaks to the next user.
+	 * \note This class is thread safe.
+	 */
+	class handle_pool {
+	public:
+		/** \brief Deleter that returns the handle to its pool */
+		struct releaser {
+			handle_pool* m_pool{nullptr};
+			void operator()(handle* hdl) const noexcept;
+		};
+		/** \brief Handle owned by a pool, it is returned to the pool once destroyed */
+		using pooled_handle = std::unique_ptr<handle, releaser>;
+
+		/**
+		 * \brief Construct a new pool
+		 * \param max_idle Maximum number of idle handles to keep, additional handles are destroyed on release
+		 */
+		explicit handle_pool(size_t max_idle = 64);
+		~handle_pool() noexcept;
+		handle_pool(const handle_pool&) = delete;
+		handle_pool& operator=(const handle_pool&) = delete;
+		handle_pool(handle_pool&&) = delete;
+		handle_pool& operator=(handle_pool&&) = delete;
+
+		/**
+		 * \brief Get a handle from the pool, creating a new one if no idle handle is available.
+		 * \return A handle in the same state as a freshly constructed one
+		 * \note The handle has to be destroyed before the pool.
+		 */
+		pooled_handle acquire();
+
+		/** \brief Get the number of idle handles */
+		size_t idle() const noexcept;
+
+		/**
+		 * \brief Get a global default pool
+		 * \note Do not keep references to this pool past the end of main because the destruction order is not predictable.
+		 */
+		static handle_pool& get_default();
+
+	private:
+		const size_t m_max_idle;
+		mutable std::mutex m_mtx;
+		std::vector<std::unique_ptr<handle>> m_idle;
+
+		void release(handle* hdl) noexcept;
+	};
+} // namespace asyncpp::curl
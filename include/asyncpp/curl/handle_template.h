@@ -0,0 +1,62 @@
+#pragma once
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/webclient.h>
+
+#include <memory>
+#include <optional>
+
+namespace asyncpp::curl {
+	/**
+	 * \brief Preconfigured handle that is cloned for every request.
+	 *
+	 * Options shared by many requests (headers, timeouts, auth, ...) are applied once to a prototype handle,
+	 * new handles are created from it using curl_easy_duphandle(), which is cheaper than applying them again.
+	 * A template created from a http_request can be attached to other requests using http_request::base_template,
+	 * these only apply the fields differing from the base request.
+	 * \note make() is thread safe as long as the prototype is not modified concurrently.
+	 * \note Cloning a handle costs more than resetting a pooled one, so this only pays off if the shared setup is expensive.
+	 */
+	class handle_template {
+	public:
+		/** \brief Construct a template with an unconfigured prototype */
+		handle_template();
+		/**
+		 * \brief Construct a template from the shared fields of a request.
+		 *
+		 * Method, headers, auth, redirect, verbose, pipewait and timeout settings are applied to the prototype.
+		 * The url, body, cookies and hooks of the request are not part of the template.
+		 * \param base The request to use as base
+		 */
+		explicit handle_template(const http_request& base);
+		~handle_template() noexcept;
+		handle_template(const handle_template&) = delete;
+		handle_template& operator=(const handle_template&) = delete;
+		handle_template(handle_template&&) = delete;
+		handle_template& operator=(handle_template&&) = delete;
+
+		/** \brief Get the prototype handle, options set on it are inherited by all handles created afterwards */
+		handle& prototype() noexcept { return m_prototype; }
+		/** \brief Get the prototype handle */
+		const handle& prototype() const noexcept { return m_prototype; }
+		/** \brief Get the request this template was created from, if any */
+		const http_request* base() const noexcept { return m_base ? &*m_base : nullptr; }
+
+		/**
+		 * \brief Create a new handle from the prototype.
+		 * \note See handle::duplicate() for the state that is copied.
+		 */
+		std::unique_ptr<handle> make() const { return m_prototype.duplicate(); }
+
+		/**
+		 * \brief Apply the request options covered by a template to a handle.
+		 * \param hdl The handle to configure
+		 * \param req The request to take the options from
+		 * \param base If not nullptr, options equal in req and base are skipped because the handle already has them
+		 */
+		static void apply_options(handle& hdl, const http_request& req, const http_request* base);
+
+	private:
+		handle m_prototype;
+		std::optional<http_request> m_base;
+	};
+} // namespace asyncpp::curl
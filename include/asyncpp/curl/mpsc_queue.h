@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace asyncpp::curl {
+	/**
+	 * \brief Multi producer, single consumer queue based on a bounded lock free ring.
+	 *
+	 * Pushing and popping does not lock or allocate as long as the ring has room.
+	 * If the ring is full, elements are pushed to a mutex protected overflow queue instead.
+	 * Once that happened, all producers keep using the overflow queue till the consumer drained it,
+	 * which keeps elements pushed by the same thread in order.
+	 * \note pop() must only be called by a single thread at a time.
+	 */
+	template<typename T>
+	class mpsc_queue {
+		// std::hardware_destructive_interference_size is not ABI stable, so we use the common value instead
+		static constexpr size_t cache_line = 64;
+		struct cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		const size_t m_mask;
+		std::unique_ptr<cell[]> m_cells;
+		alignas(cache_line) std::atomic<size_t> m_enqueue_pos{0};
+		alignas(cache_line) size_t m_dequeue_pos{0};
+		alignas(cache_line) std::atomic<bool> m_has_overflow{false};
+		std::mutex m_overflow_mtx{};
+		std::deque<T> m_overflow{};
+		std::atomic<size_t> m_overflow_size{0};
+
+		bool try_push_ring(T& value) {
+			auto pos = m_enqueue_pos.load(std::memory_order_relaxed);
+			while (true) {
+				auto& c = m_cells[pos & m_mask];
+				auto seq = c.sequence.load(std::memory_order_acquire);
+				auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+				if (diff == 0) {
+					if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						c.value = std::move(value);
+						c.sequence.store(pos + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (diff < 0) {
+					return false;
+				} else {
+					pos = m_enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+	public:
+		/**
+		 * \brief Construct a new queue
+		 * \param capacity Number of elements in the lock free ring, has to be a power of two
+		 */
+		explicit mpsc_queue(size_t capacity = 1024) : m_mask{capacity - 1}, m_cells{std::make_unique<cell[]>(capacity)} {
+			if (capacity < 2 || (capacity & (capacity - 1)) != 0) throw std::invalid_argument("capacity needs to be a power of two");
+			for (size_t i = 0; i < capacity; i++)
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		mpsc_queue(const mpsc_queue&) = delete;
+		mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+		/**
+		 * \brief Push a new element to the queue. This is safe to call from any thread.
+		 * \return true if the element was added to the lock free ring, false if it was added to the overflow queue
+		 */
+		bool push(T value) {
+			if (!m_has_overflow.load(std::memory_order_acquire) && try_push_ring(value)) return true;
+			std::unique_lock lck{m_overflow_mtx};
+			m_overflow.push_back(std::move(value));
+			m_overflow_size.store(m_overflow.size(), std::memory_order_relaxed);
+			m_has_overflow.store(true, std::memory_order_release);
+			return false;
+		}
+
+		/**
+		 * \brief Construct a new element in the queue. This is safe to call from any thread.
+		 */
+		template<typename... TArgs>
+		bool emplace(TArgs&&... args) {
+			return push(T(std::forward<TArgs>(args)...));
+		}
+
+		/**
+		 * \brief Remove the oldest element from the queue.
+		 * \return The element or std::nullopt if the queue is empty
+		 */
+		std::optional<T> pop() {
+			auto& c = m_cells[m_dequeue_pos & m_mask];
+			auto seq = c.sequence.load(std::memory_order_acquire);
+			if (seq == m_dequeue_pos + 1) {
+				std::optional<T> res{std::move(c.value)};
+				c.value = T{};
+				c.sequence.store(m_dequeue_pos + m_mask + 1, std::memory_order_release);
+				m_dequeue_pos++;
+				return res;
+			}
+			if (!m_has_overflow.load(std::memory_order_acquire)) return std::nullopt;
+			// A producer might still be writing to the ring, which has to be consumed before the overflow to keep the order.
+			if (m_enqueue_pos.load(std::memory_order_acquire) != m_dequeue_pos) return std::nullopt;
+			std::unique_lock lck{m_overflow_mtx};
+			if (m_overflow.empty()) return std::nullopt;
+			std::optional<T> res{std::move(m_overflow.front())};
+			m_overflow.pop_front();
+			m_overflow_size.store(m_overflow.size(), std::memory_order_relaxed);
+			if (m_overflow.empty()) m_has_overflow.store(false, std::memory_order_release);
+			return res;
+		}
+
+		/**
+		 * \brief Check if the queue is empty.
+		 * \note This must only be called by the consumer. Elements that are still being pushed count as not empty, even though pop() can not return them yet.
+		 */
+		bool empty() const noexcept { return m_enqueue_pos.load(std::memory_order_acquire) == m_dequeue_pos && !m_has_overflow.load(std::memory_order_acquire); }
+
+		/**
+		 * \brief Get the number of elements in the queue.
+		 * \note This must only be called by the consumer. The result is only an estimate if producers are active.
+		 */
+		size_t size() const noexcept {
+			return m_enqueue_pos.load(std::memory_order_relaxed) - m_dequeue_pos + m_overflow_size.load(std::memory_order_relaxed);
+		}
+
+		/** \brief Get the number of elements the lock free ring can hold */
+		size_t capacity() const noexcept { return m_mask + 1; }
+	};
+} // namespace asyncpp::curl
@@ -1,6 +1,9 @@
 #pragma once
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <mutex>
 #include <span>
 #ifdef __linux__
@@ -16,6 +19,9 @@ namespace asyncpp::curl {
 		std::recursive_mutex m_mtx;
 		void* m_instance;
 		int m_wakeup; // eventfd used to implement poll & wakeup on pre 7.68.0
+		std::function<void(uint64_t fd, int what)> m_socket_callback{};
+		std::function<void(std::chrono::milliseconds timeout)> m_timer_callback{};
+
 	public:
 		multi();
 		~multi() noexcept;
@@ -39,6 +45,22 @@ namespace asyncpp::curl {
 		void wakeup();
 		void fdset(fd_set& read_set, fd_set& write_set, fd_set& exc_set, int& max_fd);
 
+		/** \brief Socket value passed to socket_action() to signal a timeout instead of socket activity */
+		static constexpr uint64_t socket_timeout = (std::numeric_limits<uint64_t>::max)();
+		void socket_action(uint64_t fd, int ev_bitmask, int* still_running);
+		/**
+		 * \brief Set a callback that is invoked when curl wants to change the events monitored on a socket.
+		 * \param cb Callback receiving the socket and one of the CURL_POLL_* values, pass nullptr to remove it
+		 * \note Exceptions thrown by the callback cause the current call into curl to fail.
+		 */
+		void set_socket_function(std::function<void(uint64_t fd, int what)> cb);
+		/**
+		 * \brief Set a callback that is invoked when curl wants to change the timeout for socket_action(socket_timeout).
+		 * \param cb Callback receiving the new timeout, a negative value removes the timeout. Pass nullptr to remove it.
+		 * \note The callback must not call socket_action() itself.
+		 */
+		void set_timer_function(std::function<void(std::chrono::milliseconds timeout)> cb);
+
 		enum class event_code { done = 1 };
 		struct event {
 			event_code code;
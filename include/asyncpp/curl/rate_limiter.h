@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace asyncpp::curl {
+	/**
+	 * \brief Token bucket rate limiter.
+	 *
+	 * The bucket is refilled with rate() tokens per second up to burst() tokens. Every request takes one token.
+	 * If no token is available, reserve() takes one from the future and returns the time at which the caller may proceed,
+	 * so callers queue up in order without having to block a thread. When attached to an executor the wait is done using its timers.
+	 * \note This class is thread safe and can be shared between multiple executors.
+	 */
+	class rate_limiter {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		/** \brief Statistics of a rate limiter */
+		struct statistics {
+			/** \brief Number of tokens taken */
+			uint64_t acquired{0};
+			/** \brief Number of requests that had to wait for a token */
+			uint64_t delayed{0};
+			/** \brief Sum of the time all delayed requests had to wait */
+			std::chrono::nanoseconds total_wait{0};
+			/** \brief Longest time a request had to wait */
+			std::chrono::nanoseconds max_wait{0};
+		};
+
+		/**
+		 * \brief Construct a new rate limiter
+		 * \param rate Number of tokens added per second
+		 * \param burst Maximum number of tokens in the bucket, the bucket starts out full
+		 */
+		rate_limiter(double rate, double burst);
+
+		/**
+		 * \brief Take a token, waiting for it if required.
+		 * \param now The current time
+		 * \return The point in time at which the token becomes available, now if it is available right away
+		 */
+		clock::time_point reserve(clock::time_point now = clock::now());
+		/**
+		 * \brief Take a token if one is available right away.
+		 * \param now The current time
+		 * \return true if a token was taken
+		 */
+		bool try_acquire(clock::time_point now = clock::now());
+		/**
+		 * \brief Return a token that was taken but not used, e.g. because the request was cancelled while waiting.
+		 * \param now The current time
+		 */
+		void release(clock::time_point now = clock::now());
+
+		/**
+		 * \brief Get the number of tokens currently in the bucket.
+		 * \note This is negative if there are outstanding reservations.
+		 */
+		double tokens(clock::time_point now = clock::now()) const;
+		/** \brief Get a snapshot of the statistics */
+		statistics stats() const;
+
+		/** \brief Get the number of tokens added per second */
+		double rate() const noexcept { return m_rate; }
+		/** \brief Get the maximum number of tokens in the bucket */
+		double burst() const noexcept { return m_burst; }
+
+	private:
+		const double m_rate;
+		const double m_burst;
+		mutable std::mutex m_mtx;
+		mutable double m_tokens;
+		mutable clock::time_point m_last;
+		statistics m_stats;
+
+		void refill(clock::time_point now) const noexcept;
+	};
+} // namespace asyncpp::curl
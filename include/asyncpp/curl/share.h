@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <mutex>
+
+namespace asyncpp::curl {
+	/**
+	 * \brief Wrapper around a curl share handle.
+	 *
+	 * Allows multiple handles to share caches, even if they are used by different executors (and threads).
+	 * By default the DNS cache and TLS sessions are shared, which avoids repeated DNS lookups and full
+	 * TLS handshakes when traffic to the same host is spread across executors.
+	 * Access to the shared data is serialized using one mutex per kind of data.
+	 * \note libcurl does not support using a shared connection cache from multiple threads at once, even with locking.
+	 *       Only enable CURL_LOCK_DATA_CONNECT if all handles using the share run on the same executor thread.
+	 * \note The share has to outlive all handles using it, which is guaranteed when it is attached using a std::shared_ptr.
+	 */
+	class share {
+		void* m_instance;
+		// One lock per curl_lock_data value
+		std::array<std::mutex, 16> m_locks{};
+
+	public:
+		/** \brief Construct a new share handle, sharing the DNS cache and TLS sessions */
+		share();
+		~share() noexcept;
+		share(const share&) = delete;
+		share& operator=(const share&) = delete;
+		share(share&&) = delete;
+		share& operator=(share&&) = delete;
+
+		/**
+		 * \brief Get the raw CURLSH handle. Use with caution.
+		 */
+		void* raw() const noexcept { return m_instance; }
+
+		/**
+		 * \brief Enable or disable sharing of a kind of data.
+		 * \param data The data to share (one of CURL_LOCK_DATA_*)
+		 * \param enabled true to share the data, false to stop sharing it
+		 * \note This must not be called while the share is attached to any handle.
+		 */
+		void set_shared(int data, bool enabled = true);
+	};
+} // namespace asyncpp::curl
@@ -5,9 +5,11 @@
 #include <cstddef>
 #include <cstdint>
 #include <mutex>
+#include <string_view>
 
 namespace asyncpp::curl {
 	class executor;
+	class executor_pool;
 	class tcp_client {
 	public:
 		/**
@@ -15,6 +17,13 @@ namespace asyncpp::curl {
 		 * \param e The executor to use for the connection
 		 */
 		tcp_client(executor& e);
+		/**
+		 * \brief Construct a new tcp client
+		 * \param pool The executor pool to select the executor for the connection from
+		 * \param host The remote host the client connects to, used by executor_pool::placement::host_hash.
+		 *             If empty, host_hash falls back to round robin.
+		 */
+		tcp_client(executor_pool& pool, std::string_view host = {});
 		/** \brief Construct a new tcp client using the default executor */
 		tcp_client();
 		/** \brief Destructor */
@@ -58,6 +67,8 @@ namespace asyncpp::curl {
 		 * \return ssize_t Number of bytes read, or
 		 *			- -1 if no data is available (EAGAIN)
 		 *			- 0 if the connection was closed
+		 * \note If the handle is bound to the executor (see handle::set_owner()) the handle mutex is skipped,
+		 *       but the call still serializes with disconnect() and has to be made on the executor thread.
 		 */
 		std::ptrdiff_t recv_raw(void* buffer, size_t buflen);
 
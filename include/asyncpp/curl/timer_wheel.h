@@ -0,0 +1,103 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace asyncpp::curl {
+	/**
+	 * \brief Hierarchical timer wheel used to manage scheduled invocables.
+	 *
+	 * Timers are sorted into 4 levels of 64 slots with a resolution of one millisecond,
+	 * which allows insert and cancel in O(1). Timers are never reported as expired before their deadline.
+	 * \note This class is not thread safe.
+	 */
+	class timer_wheel {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		/** \brief Identifies a timer inside the wheel. Ids of fired or cancelled timers become invalid. */
+		struct timer_id {
+			uint32_t index{invalid_index};
+			uint32_t generation{0};
+		};
+
+		/**
+		 * \brief Construct a new timer wheel
+		 * \param now The point in time the wheel starts at
+		 */
+		explicit timer_wheel(clock::time_point now = clock::now());
+		timer_wheel(const timer_wheel&) = delete;
+		timer_wheel& operator=(const timer_wheel&) = delete;
+
+		/**
+		 * \brief Add a new timer
+		 * \param deadline Point in time at which the timer expires
+		 * \param fn Invocable to return from expire() once the deadline is reached
+		 * \return An id that can be used to cancel the timer
+		 */
+		timer_id insert(clock::time_point deadline, std::function<void()> fn);
+		/**
+		 * \brief Cancel a timer
+		 * \param id The id returned from insert
+		 * \return true if the timer was cancelled, false if it already expired or the id is invalid
+		 */
+		bool cancel(timer_id id);
+		/**
+		 * \brief Remove all timers that expired at the given point in time.
+		 * \param now The current time
+		 * \param out Vector to append the invocables of expired timers to, ordered by deadline
+		 */
+		void expire(clock::time_point now, std::vector<std::function<void()>>& out);
+		/**
+		 * \brief Get the point in time the wheel needs to be expired at next.
+		 * \return The time point or clock::time_point::max() if the wheel is empty
+		 * \note This might be earlier than the next deadline for timers far in the future, in which case expire() just moves them to a lower level.
+		 */
+		clock::time_point next_expiry() const noexcept;
+
+		/** \brief Get the number of active timers */
+		size_t size() const noexcept { return m_size; }
+		/** \brief Check if there are no active timers */
+		bool empty() const noexcept { return m_size == 0; }
+
+	private:
+		static constexpr uint32_t invalid_index = ~uint32_t{0};
+		static constexpr size_t slot_bits = 6;
+		static constexpr size_t num_slots = size_t{1} << slot_bits;
+		static constexpr size_t num_levels = 4;
+		// List ids used for timers in the current tick and timers beyond the range of the top level
+		static constexpr size_t due_list = num_levels * num_slots;
+		static constexpr size_t overflow_list = due_list + 1;
+		static constexpr size_t num_lists = overflow_list + 1;
+
+		struct node {
+			clock::time_point deadline{};
+			uint64_t tick{0};
+			std::function<void()> fn{};
+			uint32_t prev{invalid_index};
+			uint32_t next{invalid_index};
+			uint32_t list{invalid_index};
+			uint32_t generation{0};
+		};
+
+		clock::time_point m_start;
+		uint64_t m_tick;
+		size_t m_size;
+		uint32_t m_free;
+		std::vector<node> m_nodes;
+		uint32_t m_lists[num_lists];
+		uint64_t m_occupied[num_levels];
+		std::vector<uint32_t> m_expired;
+
+		uint64_t to_tick(clock::time_point tp) const noexcept;
+		uint64_t next_event_tick() const noexcept;
+		void place(uint32_t idx);
+		void link(uint32_t idx, size_t list);
+		void unlink(uint32_t idx);
+		void release(uint32_t idx);
+		void cascade(size_t list);
+		void advance(uint64_t target);
+	};
+} // namespace asyncpp::curl
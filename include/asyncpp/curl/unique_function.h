@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace asyncpp::curl {
+	template<typename Sig>
+	class unique_function;
+
+	/**
+	 * \brief Move only replacement for std::function with a larger inline buffer.
+	 *
+	 * Invocables up to inline_size bytes that are nothrow move constructible are stored inline,
+	 * which covers a std::function plus a few captures, so wrapping them does not allocate.
+	 * Larger invocables are moved to the heap.
+	 */
+	template<typename R, typename... Args>
+	class unique_function<R(Args...)> {
+	public:
+		static constexpr size_t inline_size = 6 * sizeof(void*);
+
+	private:
+		struct vtable {
+			R (*invoke)(void* self, Args&&... args);
+			void (*move)(void* dst, void* src) noexcept;
+			void (*destroy)(void* self) noexcept;
+		};
+
+		template<typename FN>
+		static constexpr bool is_inline = sizeof(FN) <= inline_size && alignof(FN) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<FN>;
+
+		template<typename FN>
+		static constexpr vtable inline_vtable{
+			[](void* self, Args&&... args) -> R { return std::invoke(*static_cast<FN*>(self), std::forward<Args>(args)...); },
+			[](void* dst, void* src) noexcept {
+				::new (dst) FN(std::move(*static_cast<FN*>(src)));
+				static_cast<FN*>(src)->~FN();
+			},
+			[](void* self) noexcept { static_cast<FN*>(self)->~FN(); },
+		};
+
+		template<typename FN>
+		static constexpr vtable heap_vtable{
+			[](void* self, Args&&... args) -> R { return std::invoke(**static_cast<FN**>(self), std::forward<Args>(args)...); },
+			[](void* dst, void* src) noexcept { *static_cast<FN**>(dst) = *static_cast<FN**>(src); },
+			[](void* self) noexcept { delete *static_cast<FN**>(self); },
+		};
+
+		alignas(std::max_align_t) std::byte m_storage[inline_size];
+		const vtable* m_vtable{nullptr};
+
+	public:
+		unique_function() noexcept = default;
+		unique_function(std::nullptr_t) noexcept {}
+		template<typename FN>
+		requires(!std::is_same_v<std::remove_cvref_t<FN>, unique_function> && std::is_invocable_r_v<R, std::decay_t<FN>&, Args...>)
+		unique_function(FN&& fn) {
+			using fn_type = std::decay_t<FN>;
+			if constexpr (std::is_pointer_v<fn_type> || std::is_member_pointer_v<fn_type> ||
+						  std::is_same_v<fn_type, std::function<R(Args...)>>) {
+				if (!fn) return;
+			}
+			if constexpr (is_inline<fn_type>) {
+				::new (static_cast<void*>(m_storage)) fn_type(std::forward<FN>(fn));
+				m_vtable = &inline_vtable<fn_type>;
+			} else {
+				*reinterpret_cast<fn_type**>(m_storage) = new fn_type(std::forward<FN>(fn));
+				m_vtable = &heap_vtable<fn_type>;
+			}
+		}
+		unique_function(unique_function&& other) noexcept : m_vtable{std::exchange(other.m_vtable, nullptr)} {
+			if (m_vtable) m_vtable->move(m_storage, other.m_storage);
+		}
+		unique_function& operator=(unique_function&& other) noexcept {
+			if (this != &other) {
+				reset();
+				m_vtable = std::exchange(other.m_vtable, nullptr);
+				if (m_vtable) m_vtable->move(m_storage, other.m_storage);
+			}
+			return *this;
+		}
+		unique_function& operator=(std::nullptr_t) noexcept {
+			reset();
+			return *this;
+		}
+		unique_function(const unique_function&) = delete;
+		unique_function& operator=(const unique_function&) = delete;
+		~unique_function() noexcept { reset(); }
+
+		/** \brief Destroy the stored invocable */
+		void reset() noexcept {
+			if (m_vtable) std::exchange(m_vtable, nullptr)->destroy(m_storage);
+		}
+
+		/** \brief Check if a invocable is stored */
+		explicit operator bool() const noexcept { return m_vtable != nullptr; }
+
+		/**
+		 * \brief Get a pointer to the stored invocable.
+		 * \tparam FN The type the unique_function was constructed from (after decay)
+		 * \note The type is not checked, passing a different type or calling this on an empty unique_function is undefined behaviour.
+		 */
+		template<typename FN>
+		FN* target() noexcept {
+			if constexpr (is_inline<FN>)
+				return std::launder(reinterpret_cast<FN*>(m_storage));
+			else
+				return *std::launder(reinterpret_cast<FN**>(m_storage));
+		}
+
+		/**
+		 * \brief Call the stored invocable.
+		 * \note Calling an empty unique_function is undefined behaviour.
+		 */
+		R operator()(Args... args) { return m_vtable->invoke(m_storage, std::forward<Args>(args)...); }
+	};
+} // namespace asyncpp::curl
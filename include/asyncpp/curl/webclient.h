@@ -8,12 +8,15 @@
 #include <exception>
 #include <functional>
 #include <map>
+#include <memory>
 #include <stop_token>
 #include <variant>
 
 namespace asyncpp::curl {
 	class executor;
+	class executor_pool;
 	class handle;
+	class handle_template;
 
 	struct http_response {
 		struct ignore_body {};
@@ -30,6 +33,8 @@ namespace asyncpp::curl {
 		std::vector<cookie> cookies;
 		/** \brief The response body if the store mode was inline_body */
 		std::string body;
+		/** \brief Time the request waited for a rate limit or a free per host slot of the executor before it was started */
+		std::chrono::nanoseconds queue_time{0};
 	};
 
 	struct http_request {
@@ -50,6 +55,11 @@ namespace asyncpp::curl {
 		bool follow_redirects{true};
 		/** \brief Enable verbose logging of curl */
 		bool verbose{false};
+		/**
+		 * \brief Wait for an existing connection to the host to confirm whether it can multiplex instead of opening a new one (CURLOPT_PIPEWAIT).
+		 * Useful for many parallel requests to a HTTP/2 host, at the cost of some latency for the first requests.
+		 */
+		bool pipewait{false};
 		/** \brief Timeout for the entire operation, set to 0 to disable */
 		std::chrono::milliseconds timeout{0};
 		/** \brief Timeout for connecting (namelookup, proxy handling, connect), set to 0 to disable */
@@ -58,6 +68,11 @@ namespace asyncpp::curl {
 		std::function<void(handle&)> configure_hook;
 		/** \brief Hook executed right after performing the request. Can be used to read custom curl info if needed. */
 		std::function<void(handle&)> result_hook;
+		/**
+		 * \brief Template to clone the handle from instead of setting it up from scratch.
+		 * \note If the template was created from a request only the fields differing from it are applied, see handle_template.
+		 */
+		std::shared_ptr<const handle_template> base_template{};
 
 		static http_request make_get(uri url);
 		static http_request make_head(uri url);
@@ -97,5 +112,9 @@ namespace asyncpp::curl {
 		execute_awaiter execute_async(std::stop_token st, http_response::body_storage_t body_store_method, executor& exec) {
 			return execute_awaiter{*this, std::move(body_store_method), &exec, std::move(st)};
 		}
+		/** \brief Execute the request on an executor of the given pool, selected using the remote host */
+		execute_awaiter execute_async(http_response::body_storage_t body_store_method, executor_pool& pool);
+		/** \brief Execute the request on an executor of the given pool, selected using the remote host */
+		execute_awaiter execute_async(std::stop_token st, http_response::body_storage_t body_store_method, executor_pool& pool);
 	};
 } // namespace asyncpp::curl
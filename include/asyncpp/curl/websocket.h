@@ -5,9 +5,11 @@
 #include <functional>
 #include <map>
 #include <span>
+#include <string_view>
 
 namespace asyncpp::curl {
 	class executor;
+	class executor_pool;
 	class uri;
 	namespace detail {
 		struct websocket_state;
@@ -31,6 +33,12 @@ namespace asyncpp::curl {
 		using buffer = std::span<const std::byte>;
 
 		websocket(executor& e);
+		/**
+		 * \brief Construct a websocket using an executor of the pool
+		 * \param pool The executor pool to select the executor for the connection from
+		 * \param host The host passed to connect(), used by executor_pool::placement::host_hash. If empty, host_hash falls back to round robin.
+		 */
+		websocket(executor_pool& pool, std::string_view host = {});
 		websocket();
 		~websocket();
 
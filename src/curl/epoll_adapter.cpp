@@ -0,0 +1,98 @@
+#include <asyncpp/curl/epoll_adapter.h>
+#ifdef __linux__
+#include <asyncpp/curl/multi.h>
+#include <cerrno>
+#include <curl/curl.h>
+#include <curl/multi.h>
+#include <stdexcept>
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace asyncpp::curl {
+	epoll_adapter::epoll_adapter(multi& m) : m_multi{m}, m_epoll_fd{-1}, m_timer_fd{-1}, m_still_running{0} {
+		m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (m_epoll_fd < 0) throw std::runtime_error("failed to create epoll instance");
+		m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+		epoll_event evt{};
+		evt.events = EPOLLIN;
+		evt.data.fd = m_timer_fd;
+		if (m_timer_fd < 0 || epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_timer_fd, &evt) != 0) {
+			if (m_timer_fd >= 0) close(m_timer_fd);
+			close(m_epoll_fd);
+			throw std::runtime_error("failed to create timerfd");
+		}
+		try {
+			m_multi.set_socket_function([this](uint64_t fd, int what) { this->update_socket(fd, what); });
+			m_multi.set_timer_function([this](std::chrono::milliseconds timeout) { this->update_timer(timeout.count()); });
+		} catch (...) {
+			m_multi.set_socket_function(nullptr);
+			close(m_timer_fd);
+			close(m_epoll_fd);
+			throw;
+		}
+	}
+
+	epoll_adapter::~epoll_adapter() noexcept {
+		try {
+			m_multi.set_socket_function(nullptr);
+			m_multi.set_timer_function(nullptr);
+		} catch (...) {}
+		close(m_timer_fd);
+		close(m_epoll_fd);
+	}
+
+	void epoll_adapter::update_socket(uint64_t fd, int what) { update_epoll(m_epoll_fd, fd, what); }
+
+	void epoll_adapter::update_epoll(int epoll_fd, uint64_t fd, int what) {
+		epoll_event evt{};
+		evt.data.fd = static_cast<int>(fd);
+		if (what == CURL_POLL_REMOVE) {
+			// The socket might already be closed, so we ignore failures here
+			epoll_ctl(epoll_fd, EPOLL_CTL_DEL, static_cast<int>(fd), &evt);
+			return;
+		}
+		evt.events = ((what & CURL_POLL_IN) ? static_cast<uint32_t>(EPOLLIN) : 0u) | ((what & CURL_POLL_OUT) ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, static_cast<int>(fd), &evt) == 0) return;
+		if (errno == ENOENT && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, static_cast<int>(fd), &evt) == 0) return;
+		throw std::runtime_error("failed to update socket");
+	}
+
+	void epoll_adapter::update_timer(long timeout_ms) {
+		// A zero timeout would disarm the timerfd, so we use the shortest possible one instead
+		itimerspec spec{};
+		if (timeout_ms == 0)
+			spec.it_value.tv_nsec = 1;
+		else if (timeout_ms > 0) {
+			spec.it_value.tv_sec = timeout_ms / 1000;
+			spec.it_value.tv_nsec = (timeout_ms % 1000) * 1000000;
+		}
+		if (timerfd_settime(m_timer_fd, 0, &spec, nullptr) != 0) throw std::runtime_error("failed to arm timerfd");
+	}
+
+	size_t epoll_adapter::process() {
+		epoll_event events[64];
+		auto n = epoll_wait(m_epoll_fd, events, 64, 0);
+		if (n < 0) {
+			if (errno == EINTR) return 0;
+			throw std::runtime_error("epoll_wait failed");
+		}
+		for (int i = 0; i < n; i++) {
+			if (events[i].data.fd == m_timer_fd) {
+				uint64_t expirations;
+				auto unused = read(m_timer_fd, &expirations, sizeof(expirations));
+				static_cast<void>(unused); // We dont care about the result
+				m_multi.socket_action(multi::socket_timeout, 0, &m_still_running);
+				continue;
+			}
+			int mask = 0;
+			if (events[i].events & EPOLLIN) mask |= CURL_CSELECT_IN;
+			if (events[i].events & EPOLLOUT) mask |= CURL_CSELECT_OUT;
+			if (events[i].events & (EPOLLERR | EPOLLHUP)) mask |= CURL_CSELECT_ERR;
+			m_multi.socket_action(static_cast<uint64_t>(events[i].data.fd), mask, &m_still_running);
+		}
+		return static_cast<size_t>(n);
+	}
+} // namespace asyncpp::curl
+#endif
@@ -1,143 +1,856 @@
+#include <asyncpp/curl/epoll_adapter.h>
 #include <asyncpp/curl/executor.h>
 #include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/rate_limiter.h>
+#include <asyncpp/curl/share.h>
 #include <curl/curl.h>
 #include <curl/multi.h>
+#include <algorithm>
+#include <bit>
 #include <future>
+#include <memory>
 #include <stdexcept>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
 
 namespace asyncpp::curl {
-	executor::executor() : m_multi{}, m_thread{}, m_mtx{}, m_exit{false}, m_queue{} {
-		m_thread = std::thread([this]() { this->worker_thread(); });
+	// Marks epoll entries of connect_only handles, the remaining bits are the handle pointer
+	constexpr uint64_t connect_only_tag = uint64_t{1} << 63;
+
+	static void apply_thread_options(const executor::options& opts) {
+#ifdef __linux__
+		if (!opts.cpu_affinity.empty()) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for (auto cpu : opts.cpu_affinity) {
+				if (cpu >= CPU_SETSIZE) throw std::invalid_argument("cpu index out of range");
+				CPU_SET(cpu, &set);
+			}
+			if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) throw std::runtime_error("failed to set executor thread affinity");
+		}
+		if (!opts.thread_name.empty()) {
+			// Linux limits thread names to 15 characters
+			auto name = opts.thread_name.substr(0, 15);
+			pthread_setname_np(pthread_self(), name.c_str());
+		}
+		if (opts.priority != 0) {
+			sched_param param{};
+			param.sched_priority = opts.priority;
+			if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) throw std::runtime_error("failed to set executor thread priority");
+		}
+#else
+		if (!opts.cpu_affinity.empty() || opts.priority != 0) throw std::runtime_error("thread affinity and priority are not supported on this platform");
+#endif
+	}
+
+	executor::executor() : executor(options{}) {}
+
+	executor::executor(const options& opts)
+		: m_options{opts}, m_multi{}, m_thread{}, m_thread_id{}, m_mtx{}, m_exit{false}, m_draining{false}, m_queue{}, m_urgent_queue{}, m_scheduled{}, m_handle_pool{}, m_num_handles{0}, m_sleeping{false}, m_wakeup_pending{false},
+		  m_wakeups_sent{0}, m_wakeups_coalesced{0}, m_epoll_fd{-1}, m_wakeup_fd{-1}, m_still_running{0},
+		  m_timer_fd{-1}, m_timer_armed{std::chrono::steady_clock::time_point::max()}, m_socket_timeout{std::chrono::steady_clock::time_point::max()}, m_last_activity{} {
+		m_multi.set_option_long(CURLMOPT_PIPELINING, m_options.multiplex ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+		m_multi.set_option_long(CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(m_options.max_host_connections));
+		m_multi.set_option_long(CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(m_options.max_total_connections));
+		if (m_options.max_connects != 0) m_multi.set_option_long(CURLMOPT_MAXCONNECTS, static_cast<long>(m_options.max_connects));
+#if CURL_AT_LEAST_VERSION(7, 67, 0)
+		if (m_options.max_concurrent_streams != 0)
+			m_multi.set_option_long(CURLMOPT_MAX_CONCURRENT_STREAMS, static_cast<long>(m_options.max_concurrent_streams));
+#endif
+#ifdef __linux__
+		// steady_clock is based on CLOCK_MONOTONIC, so deadlines can be passed to the timerfd as is.
+		m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+		if (m_timer_fd < 0) throw std::runtime_error("failed to create timerfd");
+#endif
+		if (m_options.mode == loop_mode::socket_action) {
+#ifdef __linux__
+			m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+			if (m_epoll_fd < 0) {
+				close(m_timer_fd);
+				throw std::runtime_error("failed to create epoll instance");
+			}
+			m_wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+			epoll_event evt{};
+			evt.events = EPOLLIN;
+			evt.data.fd = m_wakeup_fd;
+			epoll_event timer_evt{};
+			timer_evt.events = EPOLLIN;
+			timer_evt.data.fd = m_timer_fd;
+			if (m_wakeup_fd < 0 || epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wakeup_fd, &evt) != 0 ||
+				epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_timer_fd, &timer_evt) != 0) {
+				if (m_wakeup_fd >= 0) close(m_wakeup_fd);
+				close(m_epoll_fd);
+				close(m_timer_fd);
+				throw std::runtime_error("failed to create eventfd");
+			}
+
+			m_multi.set_socket_function([this](uint64_t fd, int what) { epoll_adapter::update_epoll(m_epoll_fd, fd, what); });
+			m_multi.set_timer_function([this](std::chrono::milliseconds timeout) {
+				if (timeout.count() < 0)
+					m_socket_timeout = std::chrono::steady_clock::time_point::max();
+				else
+					m_socket_timeout = std::chrono::steady_clock::now() + timeout;
+			});
+#else
+			throw std::runtime_error("loop_mode::socket_action is not supported on this platform");
+#endif
+		}
+		// The timerfd is part of the epoll set in socket_action mode, in poll mode it is always the first extra fd.
+		if (m_options.mode == loop_mode::poll && m_timer_fd >= 0) {
+			m_poll_fds.push_back(curl_waitfd{m_timer_fd, CURL_WAIT_POLLIN, 0});
+			m_poll_handles.push_back(nullptr);
+		}
+		if (!m_options.start_thread) {
+			// The constructing thread drives the executor until run_once() is called from another one.
+			// Otherwise synchronous calls like add_handle() before the first run_once() would wait for a thread that never runs.
+			m_thread_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+			return;
+		}
+		// Thread options are applied by the thread itself before it touches any state, so allocations happen on the right NUMA node.
+		// Failing to apply them is reported back to the constructor.
+		std::promise<void> started;
+		auto started_future = started.get_future();
+		m_thread = std::thread([this, &started]() {
+			try {
+				apply_thread_options(m_options);
+			} catch (...) {
+				started.set_exception(std::current_exception());
+				return;
+			}
+			started.set_value();
+			this->worker_thread();
+		});
+		try {
+			started_future.get();
+		} catch (...) {
+			m_thread.join();
+			this->close_fds();
+			throw;
+		}
 	}
 
 	executor::~executor() noexcept {
 		m_exit.store(true);
-		m_multi.wakeup();
-		if (m_thread.joinable()) m_thread.join();
+		signal();
+		if (m_thread.joinable())
+			m_thread.join();
+		else if (!m_options.start_thread) {
+			// Without a thread the remaining transfers and tasks are finished by the destroying thread
+			m_thread_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+			auto prev = dispatcher::current(this);
+			while (this->loop_once(-1)) {}
+			dispatcher::current(prev);
+		}
+		this->close_fds();
+	}
+
+	void executor::close_fds() noexcept {
+#ifdef __linux__
+		if (m_epoll_fd >= 0) {
+			// Cleaning up the multi might still invoke the socket callback, so we need to detach it before closing the epoll set.
+			// Removing a callback does not fail in practice and there would be nothing left to do about it here
+			try {
+				m_multi.set_socket_function(nullptr);
+				m_multi.set_timer_function(nullptr);
+			} catch (...) {}
+			close(m_wakeup_fd);
+			close(m_epoll_fd);
+		}
+		if (m_timer_fd >= 0) close(m_timer_fd);
+#endif
 	}
 
 	void executor::worker_thread() noexcept {
+		m_thread_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
 		dispatcher::current(this);
-		std::vector<curl_waitfd> fds;
-		std::vector<handle*> handles;
-		while (true) {
-			int still_running = 0;
-			{
-				std::unique_lock lck(m_mtx);
-				m_multi.perform(&still_running);
-				multi::event evt;
-				while (m_multi.next_event(evt)) {
-					std::unique_lock lck_hdl(evt.handle->m_mtx);
-					if (evt.code == multi::event_code::done) {
-						auto cb = std::exchange(evt.handle->m_done_callback, {});
-						if (!evt.handle->is_connect_only()) m_multi.remove_handle(*evt.handle);
-						if (cb) m_queue.emplace([cb = std::move(cb), res = evt.result_code]() { cb(res); });
+		while (this->loop_once(-1)) {}
+		dispatcher::current(nullptr);
+	}
+
+	bool executor::loop_once(int max_wait_ms) {
+		int still_running = 0;
+		m_sleeping.store(false, std::memory_order_relaxed);
+		m_wakeup_pending.store(false, std::memory_order_relaxed);
+		this->publish_stats();
+		m_stats.loop_iterations++;
+		auto start = std::chrono::steady_clock::now();
+		{
+			std::unique_lock lck(m_mtx);
+			this->perform(&still_running);
+			multi::event evt;
+			while (m_multi.next_event(evt)) {
+				std::unique_lock lck_hdl(evt.handle->m_mtx);
+				if (evt.code == multi::event_code::done) {
+					auto cb = std::exchange(evt.handle->m_done_callback, {});
+					if (!evt.handle->is_connect_only()) {
+						// Clearing the executor saves destroying or resetting the handle a round trip to this thread
+						evt.handle->m_executor = nullptr;
+						this->remove_transfer(*evt.handle);
+						if (m_drain) m_drain->result.finished++;
 					}
+					if (cb) m_completed.emplace_back(std::move(cb), evt.result_code);
 				}
 			}
-			while (true) {
-				auto fn = m_queue.pop();
-				if (!fn) {
-					if (m_exit && still_running == 0) return;
-					break;
-				}
-				if ((*fn)) (*fn)();
-			}
-			auto timeout = m_multi.timeout().count();
-			if (timeout == 0) continue;
-			if (timeout < 0) timeout = 500;
-			{
-				std::unique_lock lck(m_mtx);
-				if (!m_scheduled.empty()) {
-					auto now = std::chrono::steady_clock::now();
-					while (!m_scheduled.empty()) {
-						auto elem = m_scheduled.begin();
-						auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(elem->first - now).count();
-						if (diff > 100) {
-							if (timeout > diff) timeout = diff;
-							break;
-						}
-						auto fn = std::move(elem->second);
-						m_scheduled.erase(elem);
-						lck.unlock();
-						fn();
-						lck.lock();
-					}
+		}
+		auto now = std::chrono::steady_clock::now();
+		m_stats.perform_time += now - start;
+		start = now;
+		// Urgent tasks get a turn before every normal item (done callback, timer or task), see run_urgent().
+		bool active = this->run_urgent() != 0;
+		// Done callbacks (e.g. a suspended exec_awaiter) are invoked directly instead of going through the queue.
+		// The handle is no longer referenced at this point, so it is fine for the callback to destroy it.
+		active |= !m_completed.empty();
+		for (auto& [cb, res] : m_completed) {
+			cb(res);
+			this->run_urgent();
+		}
+		m_completed.clear();
+		if (m_drain) this->check_drain();
+		now = std::chrono::steady_clock::now();
+		m_stats.task_time += now - start;
+		start = now;
+		// Timers run before the queue, so tasks pushed by them are not delayed till the next wakeup.
+		this->run_timers(m_expired);
+		now = std::chrono::steady_clock::now();
+		m_stats.timer_time += now - start;
+		start = now;
+		m_stats.queue_high_water = (std::max)(m_stats.queue_high_water, m_queue.size() + m_urgent_queue.size());
+		while (true) {
+			auto task = m_queue.pop();
+			if (!task) {
+				// Whatever is left in the urgent lane does not have to share with normal tasks anymore
+				while (this->run_urgent() != 0)
+					active = true;
+				m_stats.task_time += std::chrono::steady_clock::now() - start;
+				if (m_exit && still_running == 0) {
+					this->publish_stats();
+					return false;
 				}
+				break;
 			}
-			{
-				auto num_handles = m_connect_only_handles.size();
-				fds.resize(num_handles);
-				handles.resize(num_handles);
-				for (size_t i = 0; auto e : m_connect_only_handles) {
-					auto fd = e->get_info_socket(CURLINFO_ACTIVESOCKET);
-					fds[i].events = e->is_paused(CURLPAUSE_RECV) ? 0 : (CURL_WAIT_POLLIN | CURL_WAIT_POLLPRI);
-					fds[i].events |= e->is_paused(CURLPAUSE_SEND) ? 0 : CURL_WAIT_POLLOUT;
-					if (fd == (std::numeric_limits<uint64_t>::max)() || fds[i].events == 0) {
-						num_handles--;
-						continue;
-					}
-					fds[i].fd = fd;
-					fds[i].revents = 0;
-					handles[i] = e;
-					i++;
-				}
-				int num_fds = 0;
-				m_multi.poll({fds.data(), num_handles}, timeout, &num_fds);
-				if (num_fds != 0) {
-					for (size_t i = 0; i < num_handles; i++) {
-						if (fds[i].revents & CURL_WAIT_POLLIN) {
-							if (!handles[i]->m_write_callback || handles[i]->m_write_callback(nullptr, 0) == CURL_WRITEFUNC_PAUSE)
-								handles[i]->pause(CURLPAUSE_RECV);
-						} else if (fds[i].revents & CURL_WAIT_POLLOUT) {
-							if (!handles[i]->m_read_callback || handles[i]->m_read_callback(nullptr, 0) == CURL_READFUNC_PAUSE)
-								handles[i]->pause(CURLPAUSE_SEND);
-						}
-					}
+			this->run_task(*task);
+			active = true;
+			this->run_urgent();
+		}
+		if (active) m_last_activity = now;
+		// While busy polling we never block, so there is no need to be woken up and producers can skip the signal.
+		const bool spin = m_options.busy_poll.count() > 0 && now - m_last_activity < m_options.busy_poll;
+		if (!spin) {
+			// From here on every change has to wake us, while changes made before are picked up below.
+			// The fence pairs with the one in notify(), so either we see the new task or the producer sees m_sleeping.
+			m_sleeping.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (!m_queue.empty() || !m_urgent_queue.empty()) return true;
+		}
+		{
+			// Apply pause state changes made by other threads
+			std::unique_lock lck{m_changed_mtx};
+			m_changed_local.swap(m_changed);
+			lck.unlock();
+			for (auto e : m_changed_local)
+				this->update_connect_only(*e);
+			m_changed_local.clear();
+		}
+		// When driven by run_once() the caller gets control back once work was done instead of blocking for the full timeout
+		if (active && !m_options.start_thread) max_wait_ms = 0;
+		auto timeout = this->transfer_timeout();
+		if (timeout == 0 || max_wait_ms == 0) return true;
+		auto timer = this->timer_timeout();
+		if (timer == 0) return true;
+		if (timeout < 0 || (timer >= 0 && timer < timeout)) timeout = timer;
+		if (max_wait_ms > 0 && (timeout < 0 || timeout > max_wait_ms)) timeout = max_wait_ms;
+		if (spin) timeout = 0;
+		start = std::chrono::steady_clock::now();
+		if (this->wait(timeout < 0 ? (std::numeric_limits<int>::max)() : timeout)) m_last_activity = std::chrono::steady_clock::now();
+		now = std::chrono::steady_clock::now();
+		m_stats.wait_time += now - start;
+		this->dispatch_connect_only();
+		m_stats.task_time += std::chrono::steady_clock::now() - now;
+		return true;
+	}
+
+	bool executor::run_once(std::chrono::milliseconds timeout) {
+		if (m_options.start_thread) throw std::logic_error("run_once() requires an executor without a thread");
+		// The calling thread is treated as the executor thread from now on
+		m_thread_id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+		auto prev = dispatcher::current(this);
+		auto ms = (std::min<std::chrono::milliseconds::rep>)(timeout.count(), (std::numeric_limits<int>::max)());
+		bool res = false;
+		try {
+			res = this->loop_once(ms < 0 ? -1 : static_cast<int>(ms));
+			// Handle whatever woke up the wait, otherwise it would only run on the next call
+			if (res && ms != 0) res = this->loop_once(0);
+		} catch (...) {
+			dispatcher::current(prev);
+			throw;
+		}
+		dispatcher::current(prev);
+		return res;
+	}
+
+	void executor::run_until(std::stop_token st) {
+		std::stop_callback cb{st, [this]() { this->signal(); }};
+		while (!st.stop_requested())
+			this->run_once(std::chrono::milliseconds{-1});
+	}
+
+	void executor::perform(int* still_running) {
+		if (m_options.mode == loop_mode::poll) return m_multi.perform(still_running);
+		// Socket activity is handled as part of wait(), so all thats left is to handle expired curl timeouts.
+		// During shutdown we always call into curl to refresh the number of running transfers, because removed handles do not update it.
+		if (m_socket_timeout <= std::chrono::steady_clock::now() || m_exit) {
+			m_socket_timeout = std::chrono::steady_clock::time_point::max();
+			m_multi.socket_action(multi::socket_timeout, 0, &m_still_running);
+		}
+		*still_running = m_still_running;
+	}
+
+	long executor::transfer_timeout() {
+		if (m_options.mode == loop_mode::poll) return m_multi.timeout().count();
+		if (m_socket_timeout == std::chrono::steady_clock::time_point::max()) return -1;
+		auto diff = std::chrono::ceil<std::chrono::milliseconds>(m_socket_timeout - std::chrono::steady_clock::now()).count();
+		return (std::max)(diff, decltype(diff){0});
+	}
+
+	bool executor::wait(int timeout_ms) {
+		if (m_options.mode == loop_mode::poll) {
+			int num_fds = 0;
+			m_multi.poll(m_poll_fds, timeout_ms, &num_fds);
+			if (num_fds == 0) return false;
+			for (size_t i = 0; i < m_poll_fds.size(); i++) {
+				if (m_poll_fds[i].revents == 0) continue;
+				if (m_poll_handles[i] != nullptr) m_ready.emplace_back(m_poll_handles[i], m_poll_fds[i].revents);
+#ifdef __linux__
+				// Rearming resets the timerfd, but we might not need to rearm it if the next deadline is unchanged.
+				else if (m_poll_fds[i].fd == m_timer_fd) {
+					uint64_t temp;
+					auto unused = read(m_timer_fd, &temp, sizeof(temp));
+					static_cast<void>(unused); // We dont care about the result
 				}
+#endif
 			}
+			return true;
 		}
-		dispatcher::current(nullptr);
+#ifdef __linux__
+		epoll_event events[64];
+		auto num_events = epoll_wait(m_epoll_fd, events, std::size(events), timeout_ms == (std::numeric_limits<int>::max)() ? -1 : timeout_ms);
+		std::unique_lock lck(m_mtx);
+		for (int i = 0; i < num_events; i++) {
+			if (events[i].data.u64 & connect_only_tag) {
+				// connect_only handles are dispatched once all events are collected, because their callbacks might modify the epoll set.
+				int revents = 0;
+				if (events[i].events & (EPOLLIN | EPOLLPRI)) revents |= CURL_WAIT_POLLIN;
+				if (events[i].events & EPOLLOUT) revents |= CURL_WAIT_POLLOUT;
+				if (events[i].events & (EPOLLERR | EPOLLHUP)) revents |= CURL_WAIT_POLLIN | CURL_WAIT_POLLOUT;
+				m_ready.emplace_back(reinterpret_cast<handle*>(events[i].data.u64 & ~connect_only_tag), revents);
+				continue;
+			}
+			if (events[i].data.fd == m_wakeup_fd || events[i].data.fd == m_timer_fd) {
+				uint64_t temp;
+				auto unused = read(events[i].data.fd, &temp, sizeof(temp));
+				static_cast<void>(unused); // We dont care about the result
+				continue;
+			}
+			int mask = 0;
+			if (events[i].events & EPOLLIN) mask |= CURL_CSELECT_IN;
+			if (events[i].events & EPOLLOUT) mask |= CURL_CSELECT_OUT;
+			if (events[i].events & (EPOLLERR | EPOLLHUP)) mask |= CURL_CSELECT_ERR;
+			m_multi.socket_action(events[i].data.fd, mask, &m_still_running);
+		}
+		return num_events > 0;
+#else
+		return false;
+#endif
+	}
+
+	void executor::dispatch_connect_only() {
+		for (auto [hdl, revents] : m_ready) {
+			// A previous callback might have removed (and destroyed) the handle
+			auto it = m_connect_only.find(hdl);
+			if (it == m_connect_only.end()) continue;
+			revents &= it->second.events;
+			if (revents & CURL_WAIT_POLLIN) {
+				if (!hdl->m_write_callback || hdl->m_write_callback(nullptr, 0) == CURL_WRITEFUNC_PAUSE) hdl->pause(CURLPAUSE_RECV);
+			} else if (revents & CURL_WAIT_POLLOUT) {
+				if (!hdl->m_read_callback || hdl->m_read_callback(nullptr, 0) == CURL_READFUNC_PAUSE) hdl->pause(CURLPAUSE_SEND);
+			}
+		}
+		m_ready.clear();
+	}
+
+	void executor::connect_only_changed(handle& hdl) {
+		if (this->is_executor_thread()) return this->update_connect_only(hdl);
+		std::unique_lock lck{m_changed_mtx};
+		m_changed.push_back(&hdl);
+		lck.unlock();
+		notify();
+	}
+
+	void executor::update_connect_only(handle& hdl) {
+		// This only compares the pointer, so it is fine if the handle got destroyed after being queued in m_changed.
+		auto it = m_connect_only.find(&hdl);
+		if (it == m_connect_only.end()) return;
+		auto& state = it->second;
+		auto fd = hdl.get_info_socket(CURLINFO_ACTIVESOCKET);
+		int events = hdl.is_paused(CURLPAUSE_RECV) ? 0 : (CURL_WAIT_POLLIN | CURL_WAIT_POLLPRI);
+		events |= hdl.is_paused(CURLPAUSE_SEND) ? 0 : CURL_WAIT_POLLOUT;
+		if (fd == (std::numeric_limits<uint64_t>::max)()) events = 0;
+		if (state.fd == fd && state.events == events) return;
+		if (state.fd != fd || events == 0 || state.events == 0) {
+			this->unregister_connect_only(state);
+			state.fd = fd;
+			state.events = events;
+			if (events == 0) return;
+			if (m_options.mode == loop_mode::poll) {
+				state.index = m_poll_fds.size();
+				m_poll_fds.push_back(curl_waitfd{static_cast<curl_socket_t>(fd), static_cast<short>(events), 0});
+				m_poll_handles.push_back(&hdl);
+			}
+#ifdef __linux__
+			else {
+				epoll_event evt{};
+				evt.events = ((events & CURL_WAIT_POLLIN) ? static_cast<uint32_t>(EPOLLIN | EPOLLPRI) : 0u) | ((events & CURL_WAIT_POLLOUT) ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+				evt.data.u64 = reinterpret_cast<uint64_t>(&hdl) | connect_only_tag;
+				epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, static_cast<int>(fd), &evt);
+			}
+#endif
+			return;
+		}
+		// Same socket, only the direction changed
+		state.events = events;
+		if (m_options.mode == loop_mode::poll) {
+			m_poll_fds[state.index].events = static_cast<short>(events);
+		}
+#ifdef __linux__
+		else {
+			epoll_event evt{};
+			evt.events = ((events & CURL_WAIT_POLLIN) ? static_cast<uint32_t>(EPOLLIN | EPOLLPRI) : 0u) | ((events & CURL_WAIT_POLLOUT) ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+			evt.data.u64 = reinterpret_cast<uint64_t>(&hdl) | connect_only_tag;
+			epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, static_cast<int>(fd), &evt);
+		}
+#endif
+	}
+
+	void executor::unregister_connect_only(connect_only_state& state) {
+		if (state.events == 0) return;
+		if (m_options.mode == loop_mode::poll) {
+			// Swap with the last entry to keep removal O(1)
+			auto last = m_poll_fds.size() - 1;
+			if (state.index != last) {
+				m_poll_fds[state.index] = m_poll_fds[last];
+				m_poll_handles[state.index] = m_poll_handles[last];
+				m_connect_only.at(m_poll_handles[state.index]).index = state.index;
+			}
+			m_poll_fds.pop_back();
+			m_poll_handles.pop_back();
+		}
+#ifdef __linux__
+		else {
+			epoll_event evt{};
+			epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, static_cast<int>(state.fd), &evt);
+		}
+#endif
+		state.events = 0;
+	}
+
+	void executor::run_task(queued_task& task) {
+		auto delay = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - task.queued).count();
+		m_stats.task_delay[(std::min)(static_cast<size_t>(std::bit_width(static_cast<uint64_t>((std::max)(delay, decltype(delay){0})))),
+									  statistics::task_delay_buckets - 1)]++;
+		if (task.fn) task.fn();
+	}
+
+	size_t executor::run_urgent() {
+		// Limiting the burst keeps a steady stream of urgent tasks from starving normal work
+		size_t n = 0;
+		for (; n < m_options.urgent_burst; n++) {
+			auto task = m_urgent_queue.pop();
+			if (!task) break;
+			this->run_task(*task);
+		}
+		return n;
+	}
+
+	void executor::run_timers(std::vector<std::function<void()>>& expired) {
+		{
+			std::unique_lock lck(m_mtx);
+			if (m_scheduled.empty()) return;
+			m_scheduled.expire(std::chrono::steady_clock::now(), expired);
+		}
+		// Invoke outside the lock, so callbacks can schedule or cancel timers themselves.
+		for (auto& fn : expired) {
+			if (fn) fn();
+			this->run_urgent();
+		}
+		expired.clear();
+	}
+
+	long executor::timer_timeout() {
+		std::unique_lock lck(m_mtx);
+		auto next = m_scheduled.next_expiry();
+		lck.unlock();
+		if (next == std::chrono::steady_clock::time_point::max()) {
+#ifdef __linux__
+			if (m_timer_armed != next) {
+				itimerspec spec{};
+				timerfd_settime(m_timer_fd, 0, &spec, nullptr);
+				m_timer_armed = next;
+			}
+#endif
+			return -1;
+		}
+		if (next <= std::chrono::steady_clock::now()) return 0;
+#ifdef __linux__
+		if (m_timer_armed != next) {
+			// Rearming resets the expiration count, so there is no need to read the fd here.
+			auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch()).count();
+			itimerspec spec{};
+			spec.it_value.tv_sec = ns / 1000000000;
+			spec.it_value.tv_nsec = ns % 1000000000;
+			timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+			m_timer_armed = next;
+		}
+		return -1;
+#else
+		// Round up, so we never wake up before the deadline
+		return std::chrono::ceil<std::chrono::milliseconds>(next - std::chrono::steady_clock::now()).count();
+#endif
+	}
+
+	void executor::publish_stats() noexcept {
+		constexpr auto relaxed = std::memory_order_relaxed;
+		m_published_stats.loop_iterations.store(m_stats.loop_iterations, relaxed);
+		m_published_stats.perform_time.store(m_stats.perform_time.count(), relaxed);
+		m_published_stats.wait_time.store(m_stats.wait_time.count(), relaxed);
+		m_published_stats.task_time.store(m_stats.task_time.count(), relaxed);
+		m_published_stats.timer_time.store(m_stats.timer_time.count(), relaxed);
+		m_published_stats.queue_high_water.store(m_stats.queue_high_water, relaxed);
+		m_published_stats.connect_only_handles.store(m_connect_only.size(), relaxed);
+		m_published_stats.queued_transfers.store(m_queued_transfers, relaxed);
+		for (size_t i = 0; i < statistics::task_delay_buckets; i++)
+			m_published_stats.task_delay[i].store(m_stats.task_delay[i], relaxed);
+	}
+
+	executor::statistics executor::stats() const noexcept {
+		constexpr auto relaxed = std::memory_order_relaxed;
+		statistics res{};
+		res.loop_iterations = m_published_stats.loop_iterations.load(relaxed);
+		res.perform_time = std::chrono::nanoseconds{m_published_stats.perform_time.load(relaxed)};
+		res.wait_time = std::chrono::nanoseconds{m_published_stats.wait_time.load(relaxed)};
+		res.task_time = std::chrono::nanoseconds{m_published_stats.task_time.load(relaxed)};
+		res.timer_time = std::chrono::nanoseconds{m_published_stats.timer_time.load(relaxed)};
+		res.queue_high_water = m_published_stats.queue_high_water.load(relaxed);
+		res.connect_only_handles = m_published_stats.connect_only_handles.load(relaxed);
+		res.queued_transfers = m_published_stats.queued_transfers.load(relaxed);
+		// m_num_handles is updated immediately, so it might be ahead of the published connect_only and queued counts
+		auto num_handles = m_num_handles.load(relaxed);
+		auto not_running = res.connect_only_handles + res.queued_transfers;
+		res.running_transfers = num_handles > not_running ? num_handles - not_running : 0;
+		res.wakeups = num_wakeups();
+		res.coalesced_wakeups = num_coalesced_wakeups();
+		for (size_t i = 0; i < statistics::task_delay_buckets; i++)
+			res.task_delay[i] = m_published_stats.task_delay[i].load(relaxed);
+		return res;
+	}
+
+	void executor::notify() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!m_sleeping.load(std::memory_order_relaxed) || m_wakeup_pending.exchange(true, std::memory_order_relaxed)) {
+			m_wakeups_coalesced.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		m_wakeups_sent.fetch_add(1, std::memory_order_relaxed);
+		signal();
+	}
+
+	void executor::signal() {
+#ifdef __linux__
+		if (m_wakeup_fd >= 0) {
+			uint64_t t = 1;
+			auto unused = write(m_wakeup_fd, &t, sizeof(t));
+			static_cast<void>(unused);
+			return;
+		}
+#endif
+		m_multi.wakeup();
 	}
 
 	void executor::add_handle(handle& hdl) {
-		push_wait([this, &hdl]() {
+		push_wait([this, &hdl]() { this->add_handle_impl(hdl); });
+	}
+
+	void executor::remove_handle(handle& hdl) {
+		push_wait([this, &hdl]() { this->remove_handle_impl(hdl); });
+	}
+
+	void executor::add_handle_nowait(handle& hdl) {
+		// Setting the executor right away makes sure a handle destroyed before the add ran gets removed again.
+		{
+			std::scoped_lock lck{hdl.m_mtx};
 			hdl.m_executor = this;
-			if (hdl.is_connect_only())
-				m_connect_only_handles.insert(&hdl);
-			else
-				m_multi.add_handle(hdl);
+		}
+		auto fn = [this, &hdl]() {
+			try {
+				this->add_handle_impl(hdl);
+			} catch (...) {
+				std::unique_lock lck{hdl.m_mtx};
+				hdl.m_executor = nullptr;
+				auto cb = std::exchange(hdl.m_done_callback, {});
+				lck.unlock();
+				if (cb) cb(CURLE_FAILED_INIT);
+			}
+		};
+		if (this->is_executor_thread())
+			fn();
+		else
+			this->push(std::move(fn));
+	}
+
+	void executor::remove_handle_nowait(handle& hdl) {
+		auto fn = [this, &hdl]() {
+			try {
+				this->remove_handle_impl(hdl);
+			} catch (...) {}
+		};
+		if (this->is_executor_thread())
+			fn();
+		else
+			this->push(std::move(fn));
+	}
+
+	void executor::add_handle_impl(handle& hdl) {
+		if (m_draining.load(std::memory_order_relaxed) && !hdl.is_connect_only()) throw std::logic_error("executor is draining");
+		if (m_options.share_handle && !hdl.m_share && hdl.m_multi == nullptr) hdl.set_share(m_options.share_handle);
+		hdl.m_executor = this;
+		if (hdl.is_connect_only()) {
+			if (!m_connect_only.try_emplace(&hdl, connect_only_state{(std::numeric_limits<uint64_t>::max)(), 0, 0}).second) return;
+			m_num_handles.fetch_add(1, std::memory_order_relaxed);
+			this->update_connect_only(hdl);
+		} else
+			this->add_transfer(hdl);
+	}
+
+	void executor::remove_handle_impl(handle& hdl) {
+		hdl.m_executor = nullptr;
+		if (hdl.is_connect_only()) {
+			auto it = m_connect_only.find(&hdl);
+			if (it == m_connect_only.end()) return;
+			this->unregister_connect_only(it->second);
+			m_connect_only.erase(it);
+			m_num_handles.fetch_sub(1, std::memory_order_relaxed);
+		} else
+			this->remove_transfer(hdl);
+	}
+
+	bool executor::handle_awaiter::await_ready() {
+		if (!m_parent->is_executor_thread()) return false;
+		try {
+			(m_parent->*m_operation)(*m_handle);
+		} catch (...) { m_error = std::current_exception(); }
+		return true;
+	}
+
+	void executor::handle_awaiter::await_suspend(coroutine_handle<> h) {
+		m_parent->push([this, h]() {
+			try {
+				(m_parent->*m_operation)(*m_handle);
+			} catch (...) { m_error = std::current_exception(); }
+			h.resume();
 		});
 	}
 
-	void executor::remove_handle(handle& hdl) {
-		push_wait([this, &hdl]() {
-			hdl.m_executor = nullptr;
-			if (hdl.is_connect_only())
-				m_connect_only_handles.erase(&hdl);
-			else
-				m_multi.remove_handle(hdl);
+	void executor::add_transfer(handle& hdl) {
+		if (m_transfers.contains(&hdl)) return;
+		auto now = std::chrono::steady_clock::now();
+		auto start = now;
+		if (m_options.rate_limit) start = m_options.rate_limit->reserve(now);
+		if (auto it = m_options.host_rate_limits.find(hdl.m_host); it != m_options.host_rate_limits.end() && it->second)
+			start = (std::max)(start, it->second->reserve(now));
+		hdl.m_queued = now;
+		if (start > now) {
+			auto sequence = m_delay_sequence++;
+			std::unique_lock lck(m_mtx);
+			auto timer = m_scheduled.insert(start, [this, &hdl, sequence]() {
+				// The transfer might have been removed after the timer expired
+				auto it = m_delayed.find(&hdl);
+				if (it == m_delayed.end() || it->second.sequence != sequence) return;
+				m_delayed.erase(it);
+				try {
+					this->start_transfer(hdl, true);
+				} catch (...) { this->fail_transfer(hdl); }
+			});
+			lck.unlock();
+			m_delayed.emplace(&hdl, delayed_transfer{timer, sequence});
+		} else
+			this->start_transfer(hdl, false);
+		m_transfers.insert(&hdl);
+		m_num_handles.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void executor::start_transfer(handle& hdl, bool delayed) {
+		if (m_options.max_host_transfers != 0) {
+			auto [it, inserted] = m_hosts.try_emplace(hdl.m_host);
+			auto& host = it->second;
+			if (host.running >= m_options.max_host_transfers) {
+				host.waiting.push_back(&hdl);
+				m_queued_transfers++;
+				return;
+			}
+			try {
+				m_multi.add_handle(hdl);
+			} catch (...) {
+				if (inserted) m_hosts.erase(it);
+				throw;
+			}
+			host.running++;
+		} else
+			m_multi.add_handle(hdl);
+		std::scoped_lock lck{hdl.m_mtx};
+		hdl.m_queue_time = delayed ? std::chrono::steady_clock::now() - hdl.m_queued : std::chrono::nanoseconds{0};
+	}
+
+	void executor::remove_transfer(handle& hdl) {
+		if (!m_transfers.contains(&hdl)) return;
+		if (hdl.m_multi == &m_multi) {
+			m_multi.remove_handle(hdl);
+			if (m_options.max_host_transfers != 0) this->admit_transfers(hdl.m_host);
+		} else if (auto it = m_delayed.find(&hdl); it != m_delayed.end()) {
+			std::unique_lock lck(m_mtx);
+			m_scheduled.cancel(it->second.timer);
+			lck.unlock();
+			m_delayed.erase(it);
+			this->release_rate_limits(hdl);
+		} else if (auto host = m_hosts.find(hdl.m_host); host != m_hosts.end()) {
+			auto& waiting = host->second.waiting;
+			if (auto it = std::find(waiting.begin(), waiting.end(), &hdl); it != waiting.end()) {
+				waiting.erase(it);
+				m_queued_transfers--;
+				this->release_rate_limits(hdl);
+			}
+			if (host->second.running == 0 && waiting.empty()) m_hosts.erase(host);
+		}
+		m_transfers.erase(&hdl);
+		m_num_handles.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void executor::admit_transfers(const std::string& host_name) {
+		auto it = m_hosts.find(host_name);
+		if (it == m_hosts.end()) return;
+		auto& host = it->second;
+		host.running--;
+		while (!host.waiting.empty() && host.running < m_options.max_host_transfers) {
+			auto hdl = host.waiting.front();
+			host.waiting.pop_front();
+			m_queued_transfers--;
+			try {
+				m_multi.add_handle(*hdl);
+				std::scoped_lock lck{hdl->m_mtx};
+				hdl->m_queue_time = std::chrono::steady_clock::now() - hdl->m_queued;
+				host.running++;
+			} catch (...) { this->fail_transfer(*hdl); }
+		}
+		if (host.running == 0 && host.waiting.empty()) m_hosts.erase(it);
+	}
+
+	void executor::fail_transfer(handle& hdl) {
+		// The callback is invoked from the queue because we might be called with locks held
+		std::unique_lock lck{hdl.m_mtx};
+		hdl.m_executor = nullptr;
+		auto cb = std::exchange(hdl.m_done_callback, {});
+		lck.unlock();
+		m_transfers.erase(&hdl);
+		m_num_handles.fetch_sub(1, std::memory_order_relaxed);
+		this->release_rate_limits(hdl);
+		if (cb) this->push([cb = std::move(cb)]() { cb(CURLE_FAILED_INIT); });
+	}
+
+	void executor::release_rate_limits(const handle& hdl) {
+		// Give back the tokens add_transfer() took for a transfer that never started
+		auto now = std::chrono::steady_clock::now();
+		if (m_options.rate_limit) m_options.rate_limit->release(now);
+		if (auto it = m_options.host_rate_limits.find(hdl.m_host); it != m_options.host_rate_limits.end() && it->second) it->second->release(now);
+	}
+
+	void executor::check_drain() {
+		if (!m_drain || !m_transfers.empty()) return;
+		{
+			std::unique_lock lck(m_mtx);
+			m_scheduled.cancel(m_drain->timer);
+		}
+		auto drain = std::move(m_drain);
+		drain->promise.set_value(drain->result);
+		// Without a thread drain() is waiting in run_once(), which must not block on the next wait
+		if (!m_options.start_thread) this->signal();
+	}
+
+	void executor::abort_transfers() {
+		if (!m_drain) return;
+		// Callbacks might add or remove other handles, so we work on a copy
+		std::vector<handle*> transfers(m_transfers.begin(), m_transfers.end());
+		// Abort waiting transfers first, so aborting a running one does not start them
+		std::stable_partition(transfers.begin(), transfers.end(), [this](handle* hdl) { return hdl->m_multi != &m_multi; });
+		for (auto hdl : transfers) {
+			if (!m_transfers.contains(hdl)) continue;
+			std::unique_lock lck{hdl->m_mtx};
+			auto cb = std::exchange(hdl->m_done_callback, {});
+			hdl->m_executor = nullptr;
+			// remove_transfer() might take m_mtx, which is always locked before a handle mutex
+			lck.unlock();
+			this->remove_transfer(*hdl);
+			m_drain->result.aborted++;
+			if (cb) cb(CURLE_ABORTED_BY_CALLBACK);
+		}
+		this->check_drain();
+	}
+
+	executor::drain_result executor::drain(std::chrono::steady_clock::time_point deadline) {
+		if (m_options.start_thread && this->is_executor_thread()) throw std::logic_error("drain() can not be called on the executor thread");
+		if (m_draining.exchange(true)) throw std::logic_error("executor is already draining");
+		std::promise<drain_result> promise;
+		auto result = promise.get_future();
+		this->push([this, &promise, deadline]() {
+			m_drain = std::make_unique<drain_state>(std::move(promise));
+			std::unique_lock lck(m_mtx);
+			m_drain->timer = m_scheduled.insert(deadline, [this]() { this->abort_transfers(); });
+			lck.unlock();
+			this->check_drain();
 		});
+		if (!m_options.start_thread) {
+			// Without a thread the caller drives the loop until the drain is done
+			while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				this->run_once(std::chrono::milliseconds{-1});
+		}
+		return result.get();
 	}
 
 	void executor::exec_awaiter::await_suspend(coroutine_handle<> h) noexcept {
+		// Queueing the add while holding the handle lock makes sure it runs before a removal queued by the stop callback.
+		// On the executor thread the add runs inline and might already resume the coroutine, so we must not hold the lock there.
+		std::unique_lock lck{m_handle->m_mtx, std::defer_lock};
+		if (!m_parent->is_executor_thread()) lck.lock();
 		m_handle->set_donefunction([this, h](int result) {
 			m_result = result;
 			h.resume();
 		});
-		m_parent->add_handle(*m_handle);
+		m_parent->add_handle_nowait(*m_handle);
 	}
 
 	void executor::exec_awaiter::stop_callback::operator()() {
 		std::unique_lock lck{m_handle->m_mtx};
 		auto cb = std::exchange(m_handle->m_done_callback, {});
 		if (cb) {
-			lck.unlock();
 			m_parent->push([this, cb = std::move(cb)]() {
 				std::unique_lock lck{m_handle->m_mtx};
 				m_handle->m_executor = nullptr;
-				m_parent->m_multi.remove_handle(*m_handle);
+				// See abort_transfers() for why the handle is unlocked first
 				lck.unlock();
+				m_parent->remove_transfer(*m_handle);
 				cb(CURLE_ABORTED_BY_CALLBACK);
 			});
 		}
@@ -148,29 +861,40 @@ namespace asyncpp::curl {
 		return exec_awaiter{this, &hdl, std::move(st)};
 	}
 
-	void executor::push(std::function<void()> fn) {
-		m_queue.emplace(std::move(fn));
-		if (m_thread.get_id() != std::this_thread::get_id()) m_multi.wakeup();
+	void executor::push(std::function<void()> fn) { this->push(std::move(fn), task_priority::normal); }
+
+	void executor::push(std::function<void()> fn, task_priority prio) {
+		auto& queue = prio == task_priority::urgent ? m_urgent_queue : m_queue;
+		queue.emplace(std::move(fn), std::chrono::steady_clock::now());
+		if (!this->is_executor_thread()) notify();
 	}
 
-	void executor::schedule(std::function<void()> fn, std::chrono::milliseconds timeout) {
+	executor::timer_handle executor::schedule(std::function<void()> fn, std::chrono::milliseconds timeout, task_priority prio) {
 		auto now = std::chrono::steady_clock::now();
-		this->schedule(std::move(fn), now + timeout);
+		return this->schedule(std::move(fn), now + timeout, prio);
 	}
 
-	void executor::schedule(std::function<void()> fn, std::chrono::steady_clock::time_point time) {
-		if (m_thread.get_id() == std::this_thread::get_id()) {
-			m_scheduled.emplace(time, std::move(fn));
-		} else {
-			std::unique_lock<std::mutex> lck(m_mtx);
-			m_scheduled.emplace(time, std::move(fn));
-			lck.unlock();
-			m_multi.wakeup();
-		}
+	executor::timer_handle executor::schedule(std::function<void()> fn, std::chrono::steady_clock::time_point time, task_priority prio) {
+		// Expired urgent timers move to the urgent lane, so they run ahead of the remaining timers and normal tasks.
+		if (prio == task_priority::urgent) fn = [this, fn = std::move(fn)]() mutable { m_urgent_queue.emplace(std::move(fn), std::chrono::steady_clock::now()); };
+		std::unique_lock<std::mutex> lck(m_mtx);
+		auto id = m_scheduled.insert(time, std::move(fn));
+		lck.unlock();
+		if (!this->is_executor_thread()) notify();
+		return timer_handle{this, id};
+	}
+
+	bool executor::timer_handle::cancel() {
+		if (m_parent == nullptr) return false;
+		std::unique_lock<std::mutex> lck(m_parent->m_mtx);
+		auto res = m_parent->m_scheduled.cancel(m_id);
+		lck.unlock();
+		m_parent = nullptr;
+		return res;
 	}
 
 	void executor::wakeup() {
-		if (m_thread.get_id() != std::this_thread::get_id()) m_multi.wakeup();
+		if (!this->is_executor_thread()) notify();
 	}
 
 	executor& executor::get_default() {
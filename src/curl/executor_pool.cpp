@@ -0,0 +1,69 @@
+#include <asyncpp/curl/executor_pool.h>
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace asyncpp::curl {
+	// Get the cpus the process is allowed to run on
+	static std::vector<size_t> usable_cpus() {
+		std::vector<size_t> res;
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) != 0) throw std::runtime_error("failed to get process affinity");
+		for (size_t i = 0; i < CPU_SETSIZE; i++) {
+			if (CPU_ISSET(i, &set)) res.push_back(i);
+		}
+#else
+		throw std::runtime_error("pinning executors is not supported on this platform");
+#endif
+		return res;
+	}
+
+	executor_pool::executor_pool() : executor_pool(options{}) {}
+
+	executor_pool::executor_pool(const options& opts) : m_policy{opts.policy}, m_executors{}, m_next{0} {
+		auto size = opts.size != 0 ? opts.size : (std::max)(std::thread::hardware_concurrency(), 1u);
+		m_executors.reserve(size);
+		std::vector<size_t> cpus;
+		if (opts.pin_threads) {
+			cpus = usable_cpus();
+			if (cpus.empty()) throw std::runtime_error("no usable cpus to pin executors to");
+		}
+		for (size_t i = 0; i < size; i++) {
+			auto exec_opts = opts.executor_options;
+			if (!exec_opts.thread_name.empty()) exec_opts.thread_name += "-" + std::to_string(i);
+			if (opts.pin_threads) exec_opts.cpu_affinity = {cpus[i % cpus.size()]};
+			m_executors.emplace_back(std::make_unique<executor>(exec_opts));
+		}
+	}
+
+	executor_pool::~executor_pool() noexcept = default;
+
+	executor& executor_pool::get(std::string_view host) noexcept {
+		switch (m_policy) {
+		case placement::least_loaded: {
+			executor* best = m_executors.front().get();
+			for (auto& e : m_executors) {
+				if (e->num_handles() < best->num_handles()) best = e.get();
+			}
+			return *best;
+		}
+		case placement::host_hash:
+			if (!host.empty()) return *m_executors[std::hash<std::string_view>{}(host) % m_executors.size()];
+			[[fallthrough]];
+		case placement::round_robin:
+		default: return *m_executors[m_next.fetch_add(1, std::memory_order_relaxed) % m_executors.size()];
+		}
+	}
+
+	executor_pool& executor_pool::get_default() {
+		static executor_pool instance{};
+		return instance;
+	}
+} // namespace asyncpp::curl
@@ -2,13 +2,21 @@
 #include <asyncpp/curl/executor.h>
 #include <asyncpp/curl/handle.h>
 #include <asyncpp/curl/multi.h>
+#include <asyncpp/curl/share.h>
 #include <asyncpp/curl/slist.h>
+#include <cassert>
+#include <cctype>
+#include <cstdio>
 #include <cstring>
 #include <curl/curl.h>
 #include <istream>
+#include <iterator>
 #include <mutex>
 #include <ostream>
 #include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 namespace asyncpp::curl {
 	constexpr static uint32_t FLAG_is_connect_only = 1 << 1;
@@ -16,8 +24,70 @@ namespace asyncpp::curl {
 	constexpr static uint32_t FLAG_is_verbose = 1 << 3;
 	static_assert((FLAG_is_verbose & CURLPAUSE_ALL) == 0, "Overlap between custom flags and CURLPAUSE_ALL");
 
-	handle::handle() : m_instance{nullptr}, m_multi{nullptr}, m_executor{nullptr}, m_flags{0} {
-		m_instance = curl_easy_init();
+	// The pointer option tables in handle.h do not include curl.h, so make sure every entry matches the option it stands for
+	template<CURLoption... Opts>
+	constexpr bool all_pointer_kind(pointer_kind kind) noexcept {
+		return ((option_traits<Opts>::pointer == kind) && ...);
+	}
+	static_assert(all_pointer_kind<CURLOPT_HTTPHEADER, CURLOPT_QUOTE, CURLOPT_POSTQUOTE, CURLOPT_TELNETOPTIONS, CURLOPT_PREQUOTE, CURLOPT_HTTP200ALIASES,
+								   CURLOPT_MAIL_RCPT, CURLOPT_RESOLVE, CURLOPT_PROXYHEADER, CURLOPT_CONNECT_TO>(pointer_kind::slist) &&
+					  std::size(detail::slist_options) == 10,
+				  "slist option table mismatch");
+	static_assert(all_pointer_kind<CURLOPT_WRITEDATA, CURLOPT_READDATA, CURLOPT_HEADERDATA, CURLOPT_STDERR, CURLOPT_XFERINFODATA,
+								   CURLOPT_DEBUGDATA, CURLOPT_SHARE, CURLOPT_PRIVATE, CURLOPT_SSL_CTX_DATA, CURLOPT_SOCKOPTDATA,
+								   CURLOPT_OPENSOCKETDATA, CURLOPT_SEEKDATA, CURLOPT_SSH_KEYDATA, CURLOPT_INTERLEAVEDATA, CURLOPT_CHUNK_DATA,
+								   CURLOPT_FNMATCH_DATA, CURLOPT_CLOSESOCKETDATA, CURLOPT_STREAM_DEPENDS, CURLOPT_STREAM_DEPENDS_E>(pointer_kind::object) &&
+					  std::size(detail::object_options) == 29,
+				  "object option table mismatch");
+	// CURLOPT_HTTPPOST and CURLOPT_IOCTLDATA are deprecated, so they are checked by number
+	static_assert(detail::contains(detail::object_options, CURLOPTTYPE_OBJECTPOINT + 24) && detail::contains(detail::object_options, CURLOPTTYPE_OBJECTPOINT + 131),
+				  "object option table mismatch");
+#if CURL_AT_LEAST_VERSION(7, 84, 0)
+	static_assert(all_pointer_kind<CURLOPT_MIMEPOST, CURLOPT_RESOLVER_START_DATA, CURLOPT_CURLU, CURLOPT_TRAILERDATA, CURLOPT_HSTSREADDATA,
+								   CURLOPT_HSTSWRITEDATA, CURLOPT_PREREQDATA, CURLOPT_SSH_HOSTKEYDATA>(pointer_kind::object),
+				  "object option table mismatch");
+#endif
+	static_assert(all_pointer_kind<CURLOPT_ERRORBUFFER, CURLOPT_POSTFIELDS>(pointer_kind::buffer), "buffer option mismatch");
+	static_assert(all_pointer_kind<CURLOPT_URL, CURLOPT_COPYPOSTFIELDS, CURLOPT_COOKIEFILE>(pointer_kind::string), "string option mismatch");
+
+	// Extract the host (and port) of an url, used as the key for per host limits
+	static std::string url_host(std::string_view url) {
+		if (auto pos = url.find("://"); pos != std::string_view::npos) url.remove_prefix(pos + 3);
+		url = url.substr(0, url.find_first_of("/?#"));
+		if (auto pos = url.rfind('@'); pos != std::string_view::npos) url.remove_prefix(pos + 1);
+		std::string res{url};
+		for (auto& c : res)
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		return res;
+	}
+
+	class handle::access_guard {
+		std::recursive_mutex* m_mtx;
+
+	public:
+		explicit access_guard(const handle& hdl) : m_mtx{hdl.m_owner.load(std::memory_order_acquire) ? nullptr : &hdl.m_mtx} {
+			if (m_mtx)
+				m_mtx->lock();
+			else
+				assert(hdl.is_owner_thread());
+		}
+		~access_guard() { unlock(); }
+		access_guard(const access_guard&) = delete;
+		access_guard& operator=(const access_guard&) = delete;
+
+		void unlock() noexcept {
+			if (m_mtx) std::exchange(m_mtx, nullptr)->unlock();
+		}
+	};
+
+	handle::handle() : handle(curl_easy_init()) {}
+
+	handle::handle(void* instance)
+		: m_instance{instance}, m_multi{nullptr}, m_executor{nullptr}, m_owner{nullptr}, m_owner_thread{}, m_queued{}, m_queue_time{0}, m_flags{0} {
+		// The header only callback trampolines use these instead of including curl.h
+		static_assert(func_pause == CURL_WRITEFUNC_PAUSE && func_pause == CURL_READFUNC_PAUSE, "Pause return value mismatch");
+		static_assert(pause_recv == CURLPAUSE_RECV && pause_send == CURLPAUSE_SEND, "Pause flag mismatch");
+		static_assert(std::is_same_v<data_callback, curl_write_callback> && std::is_same_v<data_callback, curl_read_callback>, "Callback signature mismatch");
 		if (!m_instance) throw std::runtime_error("failed to create curl handle");
 		set_option_ptr(CURLOPT_PRIVATE, this);
 		// We set CURLOPT_NOSIGNAL to avoid errors in MT, this is fine in most cases.
@@ -33,7 +103,11 @@ namespace asyncpp::curl {
 	void handle::set_option_long(int opt, long val) {
 		// TODO: Evaluate curl_easy_option_by_id for checking
 		if (int base = (opt / 10000) * 10000; base != CURLOPTTYPE_LONG) throw std::invalid_argument("invalid option supplied to set_option_long");
-		std::scoped_lock lck{m_mtx};
+		set_long_unchecked(opt, val);
+	}
+
+	void handle::set_long_unchecked(int opt, long val) {
+		access_guard lck{*this};
 		auto res = curl_easy_setopt(m_instance, static_cast<CURLoption>(opt), val);
 		if (res != CURLE_OK) throw exception{res};
 		if (opt == CURLOPT_CONNECT_ONLY)
@@ -45,7 +119,11 @@ namespace asyncpp::curl {
 	void handle::set_option_offset(int opt, long val) {
 		// TODO: Evaluate curl_easy_option_by_id for checking
 		if (int base = (opt / 10000) * 10000; base != CURLOPTTYPE_OFF_T) throw std::invalid_argument("invalid option supplied to set_option_long");
-		std::scoped_lock lck{m_mtx};
+		set_offset_unchecked(opt, val);
+	}
+
+	void handle::set_offset_unchecked(int opt, int64_t val) {
+		access_guard lck{*this};
 		auto res = curl_easy_setopt(m_instance, static_cast<CURLoption>(opt), static_cast<curl_off_t>(val));
 		if (res != CURLE_OK) throw exception{res};
 	}
@@ -54,17 +132,20 @@ namespace asyncpp::curl {
 		// TODO: Evaluate curl_easy_option_by_id for checking
 		if (int base = (opt / 10000) * 10000; base != CURLOPTTYPE_OBJECTPOINT && base != CURLOPTTYPE_FUNCTIONPOINT)
 			throw std::invalid_argument("invalid option supplied to set_option_ptr");
-		std::scoped_lock lck{m_mtx};
-		auto res = curl_easy_setopt(m_instance, static_cast<CURLoption>(opt), ptr);
-		if (res != CURLE_OK) throw exception{res};
+		set_ptr_unchecked(opt, ptr);
 	}
 
 	void handle::set_option_string(int opt, const char* str) {
 		// TODO: Evaluate curl_easy_option_by_id for checking
 		if (int base = (opt / 10000) * 10000; base != CURLOPTTYPE_STRINGPOINT) throw std::invalid_argument("invalid option supplied to set_option_ptr");
-		std::scoped_lock lck{m_mtx};
-		auto res = curl_easy_setopt(m_instance, static_cast<CURLoption>(opt), str);
+		set_ptr_unchecked(opt, str);
+	}
+
+	void handle::set_ptr_unchecked(int opt, const void* ptr) {
+		access_guard lck{*this};
+		auto res = curl_easy_setopt(m_instance, static_cast<CURLoption>(opt), ptr);
 		if (res != CURLE_OK) throw exception{res};
+		if (opt == CURLOPT_URL) m_host = ptr ? url_host(static_cast<const char*>(ptr)) : "";
 	}
 
 	void handle::set_option_blob(int opt, void* data, size_t data_size, bool copy) {
@@ -72,7 +153,7 @@ namespace asyncpp::curl {
 		// TODO: Evaluate curl_easy_option_by_id for checking
 		if (int base = (opt / 10000) * 10000; base != CURLOPTTYPE_BLOB) throw std::invalid_argument("invalid option supplied to set_option_blob");
 		curl_blob b{.data = data, .len = data_size, .flags = static_cast<unsigned int>(copy ? CURL_BLOB_COPY : CURL_BLOB_NOCOPY)};
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		auto res = curl_easy_setopt(m_instance, static_cast<CURLoption>(opt), &b);
 		if (res != CURLE_OK) throw exception{res};
 #else
@@ -86,32 +167,44 @@ namespace asyncpp::curl {
 	void handle::set_option_slist(int opt, slist list) {
 		// TODO: Evaluate curl_easy_option_by_id for checking
 		if (int base = (opt / 10000) * 10000; base != CURLOPTTYPE_SLISTPOINT) throw std::invalid_argument("invalid option supplied to set_option_ptr");
-		std::scoped_lock lck{m_mtx};
+		set_slist_unchecked(opt, std::move(list));
+	}
+
+	void handle::set_slist_unchecked(int opt, slist list) {
+		access_guard lck{*this};
 		auto res = curl_easy_setopt(m_instance, static_cast<CURLoption>(opt), list.m_first_node);
 		if (res != CURLE_OK) throw exception{res};
 		m_owned_slists[opt] = std::move(list);
 	}
 
-	void handle::set_url(const char* url) { set_option_ptr(CURLOPT_URL, url); }
+	void handle::clear_slist_unchecked(int opt) {
+		access_guard lck{*this};
+		auto res = curl_easy_setopt(m_instance, static_cast<CURLoption>(opt), static_cast<curl_slist*>(nullptr));
+		if (res != CURLE_OK) throw exception{res};
+		m_owned_slists.erase(opt);
+	}
+
+	void handle::set_url(const char* url) { set<CURLOPT_URL>(url); }
 
 	void handle::set_url(const std::string& url) { return set_url(url.c_str()); }
 
-	void handle::set_follow_location(bool on) { set_option_bool(CURLOPT_FOLLOWLOCATION, on); }
+	void handle::set_follow_location(bool on) { set<CURLOPT_FOLLOWLOCATION>(on); }
 
-	void handle::set_verbose(bool on) { set_option_bool(CURLOPT_VERBOSE, on); }
+	void handle::set_verbose(bool on) { set<CURLOPT_VERBOSE>(on); }
 
-	void handle::set_headers(slist list) { set_option_slist(CURLOPT_HTTPHEADER, std::move(list)); }
+	void handle::set_headers(slist list) { set<CURLOPT_HTTPHEADER>(std::move(list)); }
 
 	void handle::set_writefunction(std::function<size_t(char* ptr, size_t size)> cb) {
-		constexpr curl_write_callback real_cb = [](char* buffer, size_t size, size_t nmemb, void* udata) -> size_t {
-			auto res = static_cast<handle*>(udata)->m_write_callback(buffer, size * nmemb);
-			if (res == CURL_WRITEFUNC_PAUSE) static_cast<handle*>(udata)->m_flags |= CURLPAUSE_RECV;
-			return res;
-		};
+		// Wrapped so an empty function behaves the same as before (throws when called)
+		set_writefunction([cb = std::move(cb)](char* ptr, size_t size) -> size_t { return cb(ptr, size); });
+	}
 
-		std::scoped_lock lck{m_mtx};
-		m_write_callback = cb;
-		auto res = curl_easy_setopt(m_instance, CURLOPT_WRITEFUNCTION, real_cb);
+	void handle::set_write_callback(unique_function<size_t(char* buffer, size_t size)> cb, data_callback trampoline) {
+		// The trampoline calls the callback unchecked, a null function pointer ends up as an empty function here
+		if (!cb) throw std::invalid_argument("invalid callback");
+		access_guard lck{*this};
+		m_write_callback = std::move(cb);
+		auto res = curl_easy_setopt(m_instance, CURLOPT_WRITEFUNCTION, trampoline);
 		if (res != CURLE_OK) throw exception{res};
 		set_option_ptr(CURLOPT_WRITEDATA, this);
 	}
@@ -133,15 +226,15 @@ namespace asyncpp::curl {
 	}
 
 	void handle::set_readfunction(std::function<size_t(char* ptr, size_t size)> cb) {
-		curl_read_callback real_cb = [](char* buffer, size_t size, size_t nmemb, void* udata) -> size_t {
-			auto res = static_cast<handle*>(udata)->m_read_callback(buffer, size * nmemb);
-			if (res == CURL_READFUNC_PAUSE) static_cast<handle*>(udata)->m_flags |= CURLPAUSE_SEND;
-			return res;
-		};
+		set_readfunction([cb = std::move(cb)](char* ptr, size_t size) -> size_t { return cb(ptr, size); });
+	}
 
-		std::scoped_lock lck{m_mtx};
-		m_read_callback = cb;
-		auto res = curl_easy_setopt(m_instance, CURLOPT_READFUNCTION, real_cb);
+	void handle::set_read_callback(unique_function<size_t(char* buffer, size_t size)> cb, data_callback trampoline) {
+		// The trampoline calls the callback unchecked, a null function pointer ends up as an empty function here
+		if (!cb) throw std::invalid_argument("invalid callback");
+		access_guard lck{*this};
+		m_read_callback = std::move(cb);
+		auto res = curl_easy_setopt(m_instance, CURLOPT_READFUNCTION, trampoline);
 		if (res != CURLE_OK) throw exception{res};
 		set_option_ptr(CURLOPT_READDATA, this);
 	}
@@ -170,7 +263,7 @@ namespace asyncpp::curl {
 			return static_cast<handle*>(udata)->m_progress_callback(dltotal, dlnow, ultotal, ulnow);
 		};
 
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		m_progress_callback = cb;
 		auto res = curl_easy_setopt(m_instance, CURLOPT_XFERINFOFUNCTION, real_cb);
 		if (res != CURLE_OK) throw exception{res};
@@ -183,7 +276,7 @@ namespace asyncpp::curl {
 			return static_cast<handle*>(udata)->m_header_callback(buffer, size * nmemb);
 		};
 
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		m_header_callback = cb;
 		auto res = curl_easy_setopt(m_instance, CURLOPT_HEADERFUNCTION, real_cb);
 		if (res != CURLE_OK) throw exception{res};
@@ -210,12 +303,12 @@ namespace asyncpp::curl {
 	}
 
 	void handle::set_donefunction(std::function<void(int result)> cb) {
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		m_done_callback = cb;
 	}
 
 	void handle::perform() {
-		std::unique_lock lck{m_mtx};
+		access_guard lck{*this};
 		if (m_multi) throw std::logic_error("perform called on handle in multi");
 		auto res = curl_easy_perform(m_instance);
 		auto cb = m_done_callback;
@@ -227,9 +320,13 @@ namespace asyncpp::curl {
 	void handle::reset() {
 		if (m_executor) m_executor->remove_handle(*this);
 		if (m_multi) m_multi->remove_handle(*this);
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
+		// Cookie files are only consumed by the next transfer and curl_easy_reset() leaks them, so drop them first
+		curl_easy_setopt(m_instance, CURLOPT_COOKIEFILE, nullptr);
+		curl_easy_setopt(m_instance, CURLOPT_SHARE, nullptr);
 		curl_easy_reset(m_instance);
 		set_option_ptr(CURLOPT_PRIVATE, this);
+		set_option_bool(CURLOPT_NOSIGNAL, true);
 		m_done_callback = {};
 		m_header_callback = {};
 		m_progress_callback = {};
@@ -237,18 +334,74 @@ namespace asyncpp::curl {
 		m_write_callback = {};
 		m_flags = 0;
 		m_owned_slists.clear();
+		m_share.reset();
+		m_host.clear();
+		m_queue_time = {};
+		m_owner.store(nullptr, std::memory_order_relaxed);
+		m_owner_thread = {};
+	}
+
+	std::unique_ptr<handle> handle::duplicate() const {
+		access_guard lck{*this};
+		std::unique_ptr<handle> res{new handle(curl_easy_duphandle(m_instance))};
+		// The copied callback data pointers still point to this handle.
+		// The done callback is not copied, it belongs to the transfer of this handle (e.g. a suspended coroutine).
+		if (m_header_callback) {
+			res->m_header_callback = m_header_callback;
+			res->set_option_ptr(CURLOPT_HEADERDATA, res.get());
+		}
+		if (m_progress_callback) {
+			res->m_progress_callback = m_progress_callback;
+			res->set_option_ptr(CURLOPT_XFERINFODATA, res.get());
+		}
+		if (m_write_callback) {
+			res->set_option_ptr(CURLOPT_WRITEFUNCTION, nullptr);
+			res->set_option_ptr(CURLOPT_WRITEDATA, stdout);
+		}
+		if (m_read_callback) {
+			res->set_option_ptr(CURLOPT_READFUNCTION, nullptr);
+			res->set_option_ptr(CURLOPT_READDATA, stdin);
+		}
+		// curl only copies the pointers of slist options, so the copy needs its own lists
+		for (auto& e : m_owned_slists)
+			res->set_slist_unchecked(e.first, e.second);
+		if (m_share) res->set_share(m_share);
+		res->m_host = m_host;
+		res->m_flags = m_flags & (FLAG_is_connect_only | FLAG_is_verbose);
+		return res;
+	}
+
+	void handle::clear_owner() noexcept {
+		m_owner.store(nullptr, std::memory_order_relaxed);
+		m_owner_thread = {};
+	}
+
+	void handle::set_owner(executor* owner) {
+		std::scoped_lock lck{m_mtx};
+		if (m_owner.load(std::memory_order_relaxed) && !is_owner_thread()) throw std::logic_error("handle is bound to a different thread");
+		if (owner && !owner->is_executor_thread()) throw std::logic_error("set_owner() has to be called on the executor thread");
+		m_owner_thread = owner ? std::this_thread::get_id() : std::thread::id{};
+		// Pairs with the acquire in access_guard, so the thread id is visible to anyone who sees the owner
+		m_owner.store(owner, std::memory_order_release);
+	}
+
+	void handle::set_share(std::shared_ptr<share> shared) {
+		access_guard lck{*this};
+		auto res = curl_easy_setopt(m_instance, CURLOPT_SHARE, shared ? shared->raw() : nullptr);
+		if (res != CURLE_OK) throw exception{res};
+		m_share = std::move(shared);
 	}
 
 	void handle::upkeep() {
 #if CURL_AT_LEAST_VERSION(7, 62, 0)
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		auto res = curl_easy_upkeep(m_instance);
 		if (res != CURLE_OK) throw exception{res};
 #endif
 	}
 
 	std::ptrdiff_t handle::recv(void* buffer, size_t buflen) {
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		size_t read{};
 		auto res = curl_easy_recv(m_instance, buffer, buflen, &read);
 		if (res == CURLE_AGAIN) return -1;
@@ -257,7 +410,7 @@ namespace asyncpp::curl {
 	}
 
 	std::ptrdiff_t handle::send(const void* buffer, size_t buflen) {
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		size_t sent{};
 		auto res = curl_easy_send(m_instance, buffer, buflen, &sent);
 		if (res == CURLE_AGAIN) return -1;
@@ -266,44 +419,53 @@ namespace asyncpp::curl {
 	}
 
 	bool handle::is_connect_only() const noexcept {
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		return m_flags & FLAG_is_connect_only;
 	}
 
+	std::chrono::nanoseconds handle::get_queue_time() const noexcept {
+		access_guard lck{*this};
+		return m_queue_time;
+	}
+
 	bool handle::is_verbose() const noexcept {
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		return m_flags & FLAG_is_verbose;
 	}
 
 	void handle::pause(int dirs) {
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		auto old = m_flags;
 		m_flags |= (dirs & CURLPAUSE_ALL);
 		if (m_flags == old) return;
 		curl_easy_pause(m_instance, m_flags & CURLPAUSE_ALL);
+		// connect_only handles are polled by the executor, which needs to know the directions it should wait for
+		if (m_executor && (m_flags & FLAG_is_connect_only)) m_executor->connect_only_changed(*this);
 	}
 
 	void handle::unpause(int dirs) {
-		std::unique_lock lck{m_mtx};
+		access_guard lck{*this};
 		auto old = m_flags;
 		m_flags &= ~(dirs & CURLPAUSE_ALL);
 		if (m_flags == old) return;
 		curl_easy_pause(m_instance, m_flags & CURLPAUSE_ALL);
 		// Wake the executor/multi if theres any to make sure it gets polled soon
-		if (m_executor)
+		if (m_executor && (m_flags & FLAG_is_connect_only))
+			m_executor->connect_only_changed(*this);
+		else if (m_executor)
 			m_executor->wakeup();
 		else if (m_multi)
 			m_multi->wakeup();
 	}
 
 	bool handle::is_paused(int dir) {
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		return (m_flags & dir) != 0;
 	}
 
 	long handle::get_info_long(int info) const {
 		if ((info & CURLINFO_TYPEMASK) != CURLINFO_LONG) throw std::invalid_argument("invalid info supplied to get_info_long");
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		long p;
 		auto res = curl_easy_getinfo(m_instance, static_cast<CURLINFO>(info), &p);
 		if (res != CURLE_OK) throw exception{res};
@@ -312,7 +474,7 @@ namespace asyncpp::curl {
 
 	uint64_t handle::get_info_socket(int info) const {
 		if ((info & CURLINFO_TYPEMASK) != CURLINFO_SOCKET) throw std::invalid_argument("invalid info supplied to get_info_socket");
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		curl_socket_t p;
 		auto res = curl_easy_getinfo(m_instance, static_cast<CURLINFO>(info), &p);
 		if (res != CURLE_OK) throw exception{res};
@@ -322,7 +484,7 @@ namespace asyncpp::curl {
 
 	double handle::get_info_double(int info) const {
 		if ((info & CURLINFO_TYPEMASK) != CURLINFO_DOUBLE) throw std::invalid_argument("invalid info supplied to get_info_double");
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		double p;
 		auto res = curl_easy_getinfo(m_instance, static_cast<CURLINFO>(info), &p);
 		if (res != CURLE_OK) throw exception{res};
@@ -331,7 +493,7 @@ namespace asyncpp::curl {
 
 	const char* handle::get_info_string(int info) const {
 		if ((info & CURLINFO_TYPEMASK) != CURLINFO_STRING) throw std::invalid_argument("invalid info supplied to get_info_string");
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		char* p;
 		auto res = curl_easy_getinfo(m_instance, static_cast<CURLINFO>(info), &p);
 		if (res != CURLE_OK) throw exception{res};
@@ -340,7 +502,7 @@ namespace asyncpp::curl {
 
 	slist handle::get_info_slist(int info) const {
 		if ((info & CURLINFO_TYPEMASK) != CURLINFO_SLIST) throw std::invalid_argument("invalid info supplied to get_info_slist");
-		std::scoped_lock lck{m_mtx};
+		access_guard lck{*this};
 		struct curl_slist* p;
 		auto res = curl_easy_getinfo(m_instance, static_cast<CURLINFO>(info), &p);
 		if (res != CURLE_OK) throw exception{res};
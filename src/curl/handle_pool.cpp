@@ -0,0 +1,53 @@
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/handle_pool.h>
+#include <curl/curl.h>
+
+namespace asyncpp::curl {
+	handle_pool::handle_pool(size_t max_idle) : m_max_idle{max_idle}, m_mtx{}, m_idle{} { m_idle.reserve(max_idle); }
+
+	handle_pool::~handle_pool() noexcept = default;
+
+	void handle_pool::releaser::operator()(handle* hdl) const noexcept {
+		if (m_pool)
+			m_pool->release(hdl);
+		else
+			delete hdl;
+	}
+
+	handle_pool::pooled_handle handle_pool::acquire() {
+		std::unique_lock lck{m_mtx};
+		if (!m_idle.empty()) {
+			auto res = std::move(m_idle.back());
+			m_idle.pop_back();
+			return pooled_handle{res.release(), releaser{this}};
+		}
+		lck.unlock();
+		return pooled_handle{new handle(), releaser{this}};
+	}
+
+	size_t handle_pool::idle() const noexcept {
+		std::unique_lock lck{m_mtx};
+		return m_idle.size();
+	}
+
+	void handle_pool::release(handle* ptr) noexcept {
+		std::unique_ptr<handle> hdl{ptr};
+		// Nobody uses the handle anymore, so a binding to an executor thread does not apply to the release
+		hdl->clear_owner();
+		try {
+			hdl->reset();
+			// curl_easy_reset() keeps cookies, which must not be visible to the next user
+			hdl->set_option_string(CURLOPT_COOKIELIST, "ALL");
+		} catch (...) {
+			// A handle that failed to reset is not reused
+			return;
+		}
+		std::unique_lock lck{m_mtx};
+		if (m_idle.size() < m_max_idle) m_idle.push_back(std::move(hdl));
+	}
+
+	handle_pool& handle_pool::get_default() {
+		static handle_pool instance{};
+		return instance;
+	}
+} // namespace asyncpp::curl
@@ -0,0 +1,58 @@
+#include <asyncpp/curl/handle_template.h>
+#include <asyncpp/curl/slist.h>
+#include <curl/curl.h>
+#include <string>
+#include <utility>
+
+namespace asyncpp::curl {
+	handle_template::handle_template() : m_prototype{}, m_base{} {}
+
+	handle_template::handle_template(const http_request& base) : m_prototype{}, m_base{base} {
+		// Only the shared fields are part of the template
+		m_base->url = uri{};
+		m_base->url.auth(base.url.auth());
+		m_base->cookies.clear();
+		m_base->body_provider = http_request::no_body{};
+		m_base->configure_hook = {};
+		m_base->result_hook = {};
+		m_base->base_template = {};
+		apply_options(m_prototype, *m_base, nullptr);
+	}
+
+	handle_template::~handle_template() noexcept = default;
+
+	void handle_template::apply_options(handle& hdl, const http_request& req, const http_request* base) {
+		if (!base || req.request_method != base->request_method) hdl.set<CURLOPT_CUSTOMREQUEST>(req.request_method);
+		if (!base || req.headers != base->headers) {
+			slist out_headers{};
+			for (auto& e : req.headers) {
+				std::string hdr{e.first};
+				if (e.second.empty())
+					hdr += ";";
+				else
+					hdr += ": " + e.second;
+				out_headers.append(hdr.c_str());
+			}
+			hdl.set_headers(std::move(out_headers));
+		}
+		if (!base || req.follow_redirects != base->follow_redirects) hdl.set_follow_location(req.follow_redirects);
+		if (!base || req.verbose != base->verbose) hdl.set_verbose(req.verbose);
+		if (!base || req.pipewait != base->pipewait) hdl.set<CURLOPT_PIPEWAIT>(req.pipewait);
+		if (!base || req.timeout != base->timeout) hdl.set<CURLOPT_TIMEOUT_MS>(req.timeout.count());
+		if (!base || req.timeout_connect != base->timeout_connect) hdl.set<CURLOPT_CONNECTTIMEOUT_MS>(req.timeout_connect.count());
+		if (auto user = req.url.auth(); base ? user != base->url.auth() : !user.empty()) {
+			auto pos = user.find(":");
+			if (user.empty()) {
+				// An empty username still makes curl send an Authorization header
+				hdl.set<CURLOPT_USERNAME>(nullptr);
+				hdl.set<CURLOPT_PASSWORD>(nullptr);
+			} else if (pos != std::string::npos) {
+				hdl.set<CURLOPT_PASSWORD>(user.substr(pos + 1));
+				hdl.set<CURLOPT_USERNAME>(user.substr(0, pos));
+			} else {
+				hdl.set<CURLOPT_PASSWORD>(nullptr);
+				hdl.set<CURLOPT_USERNAME>(user);
+			}
+		}
+	}
+} // namespace asyncpp::curl
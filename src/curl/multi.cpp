@@ -110,6 +110,49 @@ namespace asyncpp::curl {
 		if (res != CURLM_OK) throw exception{res, true};
 	}
 
+	void multi::socket_action(uint64_t fd, int ev_bitmask, int* still_running) {
+		std::scoped_lock lck{m_mtx};
+		auto sock = fd == socket_timeout ? CURL_SOCKET_TIMEOUT : static_cast<curl_socket_t>(fd);
+		auto res = curl_multi_socket_action(m_instance, sock, ev_bitmask, still_running);
+		if (res != CURLM_OK) throw exception{res, true};
+	}
+
+	void multi::set_socket_function(std::function<void(uint64_t fd, int what)> cb) {
+		std::scoped_lock lck{m_mtx};
+		m_socket_callback = std::move(cb);
+		CURLMcode res;
+		if (m_socket_callback) {
+			constexpr curl_socket_callback fn = [](CURL*, curl_socket_t s, int what, void* userp, void*) -> int {
+				try {
+					static_cast<multi*>(userp)->m_socket_callback(static_cast<uint64_t>(s), what);
+					return 0;
+				} catch (...) { return -1; }
+			};
+			res = curl_multi_setopt(m_instance, CURLMOPT_SOCKETFUNCTION, fn);
+			if (res == CURLM_OK) res = curl_multi_setopt(m_instance, CURLMOPT_SOCKETDATA, this);
+		} else
+			res = curl_multi_setopt(m_instance, CURLMOPT_SOCKETFUNCTION, nullptr);
+		if (res != CURLM_OK) throw exception{res, true};
+	}
+
+	void multi::set_timer_function(std::function<void(std::chrono::milliseconds timeout)> cb) {
+		std::scoped_lock lck{m_mtx};
+		m_timer_callback = std::move(cb);
+		CURLMcode res;
+		if (m_timer_callback) {
+			constexpr curl_multi_timer_callback fn = [](CURLM*, long timeout_ms, void* userp) -> int {
+				try {
+					static_cast<multi*>(userp)->m_timer_callback(std::chrono::milliseconds{timeout_ms});
+					return 0;
+				} catch (...) { return -1; }
+			};
+			res = curl_multi_setopt(m_instance, CURLMOPT_TIMERFUNCTION, fn);
+			if (res == CURLM_OK) res = curl_multi_setopt(m_instance, CURLMOPT_TIMERDATA, this);
+		} else
+			res = curl_multi_setopt(m_instance, CURLMOPT_TIMERFUNCTION, nullptr);
+		if (res != CURLM_OK) throw exception{res, true};
+	}
+
 	bool multi::next_event(event& evt) {
 		std::scoped_lock lck{m_mtx};
 		int msgs_in_queue = -1;
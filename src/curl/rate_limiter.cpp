@@ -0,0 +1,56 @@
+#include <asyncpp/curl/rate_limiter.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace asyncpp::curl {
+	rate_limiter::rate_limiter(double rate, double burst) : m_rate{rate}, m_burst{burst}, m_mtx{}, m_tokens{burst}, m_last{clock::now()}, m_stats{} {
+		if (!(rate > 0) || !(burst >= 1)) throw std::invalid_argument("invalid rate limit");
+	}
+
+	void rate_limiter::refill(clock::time_point now) const noexcept {
+		if (now <= m_last) return;
+		m_tokens = (std::min)(m_burst, m_tokens + std::chrono::duration<double>(now - m_last).count() * m_rate);
+		m_last = now;
+	}
+
+	rate_limiter::clock::time_point rate_limiter::reserve(clock::time_point now) {
+		std::scoped_lock lck{m_mtx};
+		this->refill(now);
+		m_tokens -= 1;
+		m_stats.acquired++;
+		if (m_tokens >= 0) return now;
+		auto wait = std::chrono::ceil<std::chrono::nanoseconds>(std::chrono::duration<double>(-m_tokens / m_rate));
+		m_stats.delayed++;
+		m_stats.total_wait += wait;
+		m_stats.max_wait = (std::max)(m_stats.max_wait, wait);
+		return now + wait;
+	}
+
+	bool rate_limiter::try_acquire(clock::time_point now) {
+		std::scoped_lock lck{m_mtx};
+		this->refill(now);
+		if (m_tokens < 1) return false;
+		m_tokens -= 1;
+		m_stats.acquired++;
+		return true;
+	}
+
+	void rate_limiter::release(clock::time_point now) {
+		std::scoped_lock lck{m_mtx};
+		this->refill(now);
+		m_tokens = (std::min)(m_burst, m_tokens + 1);
+		if (m_stats.acquired != 0) m_stats.acquired--;
+	}
+
+	double rate_limiter::tokens(clock::time_point now) const {
+		std::scoped_lock lck{m_mtx};
+		this->refill(now);
+		return m_tokens;
+	}
+
+	rate_limiter::statistics rate_limiter::stats() const {
+		std::scoped_lock lck{m_mtx};
+		return m_stats;
+	}
+} // namespace asyncpp::curl
@@ -0,0 +1,38 @@
+#include <asyncpp/curl/share.h>
+#include <curl/curl.h>
+#include <stdexcept>
+
+namespace asyncpp::curl {
+	share::share() : m_instance{nullptr} {
+		static_assert(CURL_LOCK_DATA_LAST <= std::tuple_size_v<decltype(m_locks)>, "not enough locks for all curl_lock_data values");
+		m_instance = curl_share_init();
+		if (!m_instance) throw std::runtime_error("failed to create curl share handle");
+		constexpr curl_lock_function lock = [](CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+			static_cast<share*>(userptr)->m_locks[data].lock();
+		};
+		constexpr curl_unlock_function unlock = [](CURL*, curl_lock_data data, void* userptr) { static_cast<share*>(userptr)->m_locks[data].unlock(); };
+		auto res = curl_share_setopt(m_instance, CURLSHOPT_LOCKFUNC, lock);
+		if (res == CURLSHE_OK) res = curl_share_setopt(m_instance, CURLSHOPT_UNLOCKFUNC, unlock);
+		if (res == CURLSHE_OK) res = curl_share_setopt(m_instance, CURLSHOPT_USERDATA, this);
+		if (res != CURLSHE_OK) {
+			curl_share_cleanup(m_instance);
+			throw std::runtime_error(curl_share_strerror(res));
+		}
+		try {
+			set_shared(CURL_LOCK_DATA_DNS);
+			set_shared(CURL_LOCK_DATA_SSL_SESSION);
+		} catch (...) {
+			curl_share_cleanup(m_instance);
+			throw;
+		}
+	}
+
+	share::~share() noexcept {
+		if (m_instance) curl_share_cleanup(m_instance);
+	}
+
+	void share::set_shared(int data, bool enabled) {
+		auto res = curl_share_setopt(m_instance, enabled ? CURLSHOPT_SHARE : CURLSHOPT_UNSHARE, static_cast<curl_lock_data>(data));
+		if (res != CURLSHE_OK) throw std::runtime_error(curl_share_strerror(res));
+	}
+} // namespace asyncpp::curl
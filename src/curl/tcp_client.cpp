@@ -1,4 +1,5 @@
 #include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/executor_pool.h>
 #include <asyncpp/curl/tcp_client.h>
 #include <cassert>
 #include <cstddef>
@@ -10,6 +11,8 @@
 namespace asyncpp::curl {
 	tcp_client::tcp_client(curl::executor& e) : m_executor{e}, m_handle{}, m_is_connected{false} {}
 
+	tcp_client::tcp_client(executor_pool& pool, std::string_view host) : tcp_client(pool.get(host)) {}
+
 	tcp_client::tcp_client() : tcp_client(executor::get_default()) {}
 
 	tcp_client::~tcp_client() noexcept {
@@ -28,6 +31,7 @@ namespace asyncpp::curl {
 	}
 
 	std::ptrdiff_t tcp_client::recv_raw(void* buffer, size_t buflen) {
+		// Even if the handle is bound the client lock is needed, disconnect() resets the handle from any thread
 		std::unique_lock lck{m_mtx};
 		return m_handle.recv(buffer, buflen);
 	}
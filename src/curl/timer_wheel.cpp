@@ -0,0 +1,180 @@
+#include <asyncpp/curl/timer_wheel.h>
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <utility>
+
+namespace asyncpp::curl {
+	timer_wheel::timer_wheel(clock::time_point now) : m_start{now}, m_tick{0}, m_size{0}, m_free{invalid_index}, m_nodes{}, m_lists{}, m_occupied{} {
+		std::fill(std::begin(m_lists), std::end(m_lists), invalid_index);
+	}
+
+	timer_wheel::timer_id timer_wheel::insert(clock::time_point deadline, std::function<void()> fn) {
+		uint32_t idx = m_free;
+		if (idx != invalid_index) {
+			m_free = m_nodes[idx].next;
+		} else {
+			idx = static_cast<uint32_t>(m_nodes.size());
+			m_nodes.emplace_back();
+		}
+		auto& n = m_nodes[idx];
+		n.deadline = deadline;
+		n.tick = to_tick(deadline);
+		n.fn = std::move(fn);
+		place(idx);
+		m_size++;
+		return timer_id{idx, n.generation};
+	}
+
+	bool timer_wheel::cancel(timer_id id) {
+		if (id.index >= m_nodes.size()) return false;
+		auto& n = m_nodes[id.index];
+		if (n.generation != id.generation || n.list == invalid_index) return false;
+		unlink(id.index);
+		release(id.index);
+		return true;
+	}
+
+	void timer_wheel::expire(clock::time_point now, std::vector<std::function<void()>>& out) {
+		advance(to_tick(now));
+		auto head = m_lists[due_list];
+		if (head == invalid_index) return;
+		m_expired.clear();
+		auto idx = head;
+		do {
+			if (m_nodes[idx].deadline <= now) m_expired.push_back(idx);
+			idx = m_nodes[idx].next;
+		} while (idx != head);
+		std::stable_sort(m_expired.begin(), m_expired.end(), [this](uint32_t a, uint32_t b) { return m_nodes[a].deadline < m_nodes[b].deadline; });
+		for (auto e : m_expired) {
+			out.emplace_back(std::move(m_nodes[e].fn));
+			unlink(e);
+			release(e);
+		}
+	}
+
+	timer_wheel::clock::time_point timer_wheel::next_expiry() const noexcept {
+		auto result = clock::time_point::max();
+		if (auto head = m_lists[due_list]; head != invalid_index) {
+			auto idx = head;
+			do {
+				result = (std::min)(result, m_nodes[idx].deadline);
+				idx = m_nodes[idx].next;
+			} while (idx != head);
+		}
+		if (auto tick = next_event_tick(); tick != (std::numeric_limits<uint64_t>::max)())
+			result = (std::min)(result, m_start + std::chrono::milliseconds(tick));
+		return result;
+	}
+
+	uint64_t timer_wheel::to_tick(clock::time_point tp) const noexcept {
+		if (tp <= m_start) return 0;
+		if (tp == clock::time_point::max()) return (std::numeric_limits<uint64_t>::max)();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(tp - m_start).count();
+	}
+
+	uint64_t timer_wheel::next_event_tick() const noexcept {
+		auto result = (std::numeric_limits<uint64_t>::max)();
+		for (size_t level = 0; level < num_levels; level++) {
+			const auto shift = level * slot_bits;
+			const auto current = (m_tick >> shift) & (num_slots - 1);
+			// Slots at or below the current index have already been processed in this rotation
+			const auto pending = current + 1 < num_slots ? m_occupied[level] & (~uint64_t{0} << (current + 1)) : 0;
+			if (pending == 0) continue;
+			const auto slot = static_cast<uint64_t>(std::countr_zero(pending));
+			const auto base = (m_tick >> (shift + slot_bits)) << (shift + slot_bits);
+			result = (std::min)(result, base | (slot << shift));
+		}
+		if (m_lists[overflow_list] != invalid_index) {
+			constexpr auto shift = num_levels * slot_bits;
+			result = (std::min)(result, ((m_tick >> shift) + 1) << shift);
+		}
+		return result;
+	}
+
+	void timer_wheel::place(uint32_t idx) {
+		const auto tick = m_nodes[idx].tick;
+		if (tick <= m_tick) return link(idx, due_list);
+		// The timer goes into the level of the most significant slot index that differs from the current tick.
+		// This guarantees the slot is reached (and cascaded to lower levels) before the deadline.
+		const size_t level = (std::bit_width(tick ^ m_tick) - 1) / slot_bits;
+		if (level >= num_levels) return link(idx, overflow_list);
+		link(idx, level * num_slots + ((tick >> (level * slot_bits)) & (num_slots - 1)));
+	}
+
+	void timer_wheel::link(uint32_t idx, size_t list) {
+		auto& n = m_nodes[idx];
+		auto& head = m_lists[list];
+		n.list = static_cast<uint32_t>(list);
+		if (head == invalid_index) {
+			head = idx;
+			n.prev = n.next = idx;
+		} else {
+			// Lists are circular, so the tail is the predecessor of the head
+			const auto tail = m_nodes[head].prev;
+			n.prev = tail;
+			n.next = head;
+			m_nodes[tail].next = idx;
+			m_nodes[head].prev = idx;
+		}
+		if (list < due_list) m_occupied[list / num_slots] |= uint64_t{1} << (list % num_slots);
+	}
+
+	void timer_wheel::unlink(uint32_t idx) {
+		auto& n = m_nodes[idx];
+		auto& head = m_lists[n.list];
+		if (n.next == idx) {
+			head = invalid_index;
+			if (n.list < due_list) m_occupied[n.list / num_slots] &= ~(uint64_t{1} << (n.list % num_slots));
+		} else {
+			m_nodes[n.prev].next = n.next;
+			m_nodes[n.next].prev = n.prev;
+			if (head == idx) head = n.next;
+		}
+		n.prev = n.next = n.list = invalid_index;
+	}
+
+	void timer_wheel::release(uint32_t idx) {
+		auto& n = m_nodes[idx];
+		n.fn = {};
+		n.generation++;
+		n.next = m_free;
+		m_free = idx;
+		m_size--;
+	}
+
+	void timer_wheel::cascade(size_t list) {
+		const auto head = std::exchange(m_lists[list], invalid_index);
+		if (head == invalid_index) return;
+		if (list < due_list) m_occupied[list / num_slots] &= ~(uint64_t{1} << (list % num_slots));
+		auto idx = head;
+		bool last = false;
+		do {
+			const auto next = m_nodes[idx].next;
+			last = next == head;
+			place(idx);
+			idx = next;
+		} while (!last);
+	}
+
+	void timer_wheel::advance(uint64_t target) {
+		while (m_tick < target) {
+			// Jump straight to the next tick that requires any work
+			const auto next = next_event_tick();
+			if (next > target) {
+				m_tick = target;
+				return;
+			}
+			m_tick = next;
+			if ((m_tick & ((uint64_t{1} << (num_levels * slot_bits)) - 1)) == 0) cascade(overflow_list);
+			for (size_t level = num_levels - 1; level > 0; level--) {
+				const auto shift = level * slot_bits;
+				if ((m_tick & ((uint64_t{1} << shift) - 1)) != 0) continue;
+				cascade(level * num_slots + ((m_tick >> shift) & (num_slots - 1)));
+			}
+			// Level 0 timers for this tick end up in the due list
+			cascade(m_tick & (num_slots - 1));
+		}
+	}
+} // namespace asyncpp::curl
@@ -1,6 +1,9 @@
 #include <asyncpp/curl/exception.h>
 #include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/executor_pool.h>
 #include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/handle_pool.h>
+#include <asyncpp/curl/handle_template.h>
 #include <asyncpp/curl/slist.h>
 #include <asyncpp/curl/webclient.h>
 #include <asyncpp/detail/std_import.h>
@@ -88,61 +91,46 @@ namespace asyncpp::curl {
 			if (std::holds_alternative<http_request::no_body>(body_provider)) {
 				hdl.set_readfunction([](char*, size_t) -> size_t { return 0; });
 			} else if (std::holds_alternative<const std::string*>(body_provider)) {
-				hdl.set_option_bool(CURLOPT_UPLOAD, true);
-				hdl.set_option_offset(CURLOPT_INFILESIZE_LARGE, std::get<const std::string*>(body_provider)->size());
+				hdl.set<CURLOPT_UPLOAD>(true);
+				hdl.set<CURLOPT_INFILESIZE_LARGE>(std::get<const std::string*>(body_provider)->size());
 				hdl.set_readstring(*std::get<const std::string*>(body_provider));
 			} else if (std::holds_alternative<std::istream*>(body_provider)) {
-				hdl.set_option_bool(CURLOPT_UPLOAD, true);
+				hdl.set<CURLOPT_UPLOAD>(true);
 				hdl.set_readstream(*std::get<std::istream*>(body_provider));
 			} else if (std::holds_alternative<std::function<size_t(char*, size_t)>>(body_provider)) {
-				hdl.set_option_bool(CURLOPT_UPLOAD, true);
+				hdl.set<CURLOPT_UPLOAD>(true);
 				hdl.set_readfunction(std::move(std::get<std::function<size_t(char*, size_t)>>(body_provider)));
 			} else
 				throw std::logic_error("invalide variant");
 		}
 
 		void prepare_handle(handle& hdl, const http_request& req, http_response& resp, http_response::body_storage_t body_store_method) {
+			const http_request* base = req.base_template ? req.base_template->base() : nullptr;
 			// Prepare response handling
 			hdl.set_headerfunction(make_header_cb(resp));
 			set_write_cb(hdl, resp, std::move(body_store_method));
 
-			hdl.set_option_string(CURLOPT_CUSTOMREQUEST, req.request_method.c_str());
 			auto string_url = req.url.to_string();
-			hdl.set_option_string(CURLOPT_URL, string_url.c_str());
-			slist out_headers{};
-			for (auto& e : req.headers) {
-				std::string hdr{e.first};
-				if (e.second.empty())
-					hdr += ";";
-				else
-					hdr += ": " + e.second;
-				out_headers.append(hdr.c_str());
-			}
-			hdl.set_headers(std::move(out_headers));
+			hdl.set<CURLOPT_URL>(string_url);
+			handle_template::apply_options(hdl, req, base);
 			set_read_cb(hdl, req.body_provider);
-			hdl.set_follow_location(req.follow_redirects);
-			hdl.set_verbose(req.verbose);
-			hdl.set_option_long(CURLOPT_TIMEOUT_MS, req.timeout.count());
-			hdl.set_option_long(CURLOPT_CONNECTTIMEOUT_MS, req.timeout_connect.count());
-			if (auto user = req.url.auth(); !user.empty()) {
-				auto pos = user.find(":");
-				if (pos != std::string::npos) {
-					hdl.set_option_string(CURLOPT_PASSWORD, user.substr(pos + 1).c_str());
-					user.resize(pos);
-				}
-				hdl.set_option_string(CURLOPT_USERNAME, user.c_str());
-			}
-			// Wipe the cookie chain of existing cookies
-			hdl.set_option_string(CURLOPT_COOKIEFILE, "");
+			// Enable the cookie engine, pooled handles and copies of a template both start with an empty cookie chain
+			hdl.set<CURLOPT_COOKIEFILE>("");
 			for (auto& e : req.cookies) {
-				hdl.set_option_string(CURLOPT_COOKIELIST, e.to_string().c_str());
+				hdl.set<CURLOPT_COOKIELIST>(e.to_string());
 			}
 		}
+
+		handle_pool::pooled_handle acquire_handle(const http_request& req, handle_pool& pool) {
+			if (req.base_template) return handle_pool::pooled_handle{req.base_template->make().release(), handle_pool::releaser{}};
+			return pool.acquire();
+		}
 	} // namespace
 
 	http_response http_request::execute_sync(http_response::body_storage_t body_store_method) {
 		http_response response{};
-		handle hdl{};
+		auto pooled = acquire_handle(*this, handle_pool::get_default());
+		auto& hdl = *pooled;
 		prepare_handle(hdl, *this, response, std::move(body_store_method));
 
 		if (configure_hook) configure_hook(hdl);
@@ -158,10 +146,12 @@ namespace asyncpp::curl {
 	}
 
 	struct http_request::execute_awaiter::data {
-		data(executor* exec, http_request* req, std::stop_token st) : m_exec(exec, &m_handle, std::move(st)), m_request(req) {}
+		data(executor* exec, http_request* req, std::stop_token st)
+			: m_pooled_handle(acquire_handle(*req, exec->handles())), m_handle(*m_pooled_handle), m_exec(exec, &m_handle, std::move(st)), m_request(req) {}
 
+		handle_pool::pooled_handle m_pooled_handle;
+		handle& m_handle;
 		executor::exec_awaiter m_exec;
-		handle m_handle{};
 		http_request* m_request{};
 		http_response m_response{};
 	};
@@ -180,11 +170,20 @@ namespace asyncpp::curl {
 		m_impl->m_exec.await_suspend(h);
 	}
 
+	http_request::execute_awaiter http_request::execute_async(http_response::body_storage_t body_store_method, executor_pool& pool) {
+		return execute_awaiter{*this, std::move(body_store_method), &pool.get(url.host())};
+	}
+
+	http_request::execute_awaiter http_request::execute_async(std::stop_token st, http_response::body_storage_t body_store_method, executor_pool& pool) {
+		return execute_awaiter{*this, std::move(body_store_method), &pool.get(url.host()), std::move(st)};
+	}
+
 	http_response http_request::execute_awaiter::await_resume() const {
 		auto res = m_impl->m_exec.await_resume();
 		if (m_impl->m_request->result_hook) m_impl->m_request->result_hook(m_impl->m_handle);
 		if (res != CURLE_OK) throw exception(res, false);
 		m_impl->m_response.status_code = m_impl->m_handle.get_response_code();
+		m_impl->m_response.queue_time = m_impl->m_handle.get_queue_time();
 		return std::move(m_impl->m_response);
 	}
 
@@ -1,6 +1,7 @@
 #include <asyncpp/curl/base64.h>
 #include <asyncpp/curl/exception.h>
 #include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/executor_pool.h>
 #include <asyncpp/curl/sha1.h>
 #include <asyncpp/curl/tcp_client.h>
 #include <asyncpp/curl/uri.h>
@@ -168,6 +169,8 @@ namespace asyncpp::curl {
 
 	websocket::websocket() : websocket(executor::get_default()) {}
 
+	websocket::websocket(executor_pool& pool, std::string_view host) : websocket(pool.get(host)) {}
+
 	websocket::websocket(executor& e) : m_state(make_ref<detail::websocket_state>(e)) {
 		m_state->request_headers.emplace("User-Agent", std::string("asyncpp-curl, libcurl ") + curl_version());
 		m_state->request_headers.emplace("Connection", "Upgrade");
@@ -0,0 +1,81 @@
+#ifdef __linux__
+#include <asyncpp/curl/epoll_adapter.h>
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/multi.h>
+
+#include <chrono>
+#include <curl/curl.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace asyncpp::curl;
+
+TEST(ASYNCPP_CURL, EpollAdapter) {
+	// Local http server answering a fixed number of requests, so this does not depend on network access
+	constexpr size_t num_requests = 4;
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	ASSERT_EQ(bind(server, reinterpret_cast<sockaddr*>(&addr), len), 0);
+	ASSERT_EQ(listen(server, num_requests), 0);
+	ASSERT_EQ(getsockname(server, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+	std::thread http([server]() {
+		for (size_t i = 0; i < num_requests; i++) {
+			int client = accept(server, nullptr, nullptr);
+			std::string req;
+			char buf[512];
+			while (req.find("\r\n\r\n") == std::string::npos) {
+				auto n = read(client, buf, sizeof(buf));
+				if (n <= 0) break;
+				req.append(buf, n);
+			}
+			std::string resp = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: close\r\n\r\nHello";
+			auto unused = write(client, resp.data(), resp.size());
+			static_cast<void>(unused);
+			close(client);
+		}
+	});
+
+	multi m;
+	epoll_adapter adapter{m};
+	handle hdls[num_requests];
+	std::string bodies[num_requests];
+	auto url = "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/";
+	for (size_t i = 0; i < num_requests; i++) {
+		hdls[i].set_url(url);
+		hdls[i].set_writestring(bodies[i]);
+		m.add_handle(hdls[i]);
+	}
+
+	// Minimal external event loop that only knows about the adapter fd
+	size_t done = 0;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (done < num_requests && std::chrono::steady_clock::now() < deadline) {
+		pollfd pfd{adapter.native_handle(), POLLIN, 0};
+		if (::poll(&pfd, 1, 1000) <= 0) continue;
+		adapter.process();
+		multi::event evt;
+		while (m.next_event(evt)) {
+			ASSERT_EQ(evt.code, multi::event_code::done);
+			ASSERT_EQ(evt.result_code, CURLE_OK);
+			m.remove_handle(*evt.handle);
+			done++;
+		}
+	}
+	ASSERT_EQ(done, num_requests);
+	ASSERT_EQ(adapter.still_running(), 0);
+	for (auto& e : bodies)
+		ASSERT_EQ(e, "Hello");
+	close(server);
+	http.join();
+}
+#endif
@@ -0,0 +1,520 @@
+#include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/executor_pool.h>
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/multi.h>
+#include <asyncpp/curl/rate_limiter.h>
+#include <asyncpp/sync_wait.h>
+#include <asyncpp/task.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <curl/curl.h>
+#include <future>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace asyncpp::curl;
+using namespace asyncpp;
+
+namespace {
+	constexpr executor::loop_mode loop_modes[] = {
+		executor::loop_mode::poll,
+#ifdef __linux__
+		executor::loop_mode::socket_action,
+#endif
+	};
+
+#ifdef __linux__
+	// Local keep alive http server counting connections, every response is delayed by the given time
+	class keep_alive_server {
+		int m_fd;
+		uint16_t m_port;
+		std::atomic<size_t> m_connections{0};
+		std::thread m_thread;
+
+	public:
+		explicit keep_alive_server(std::chrono::milliseconds delay) {
+			m_fd = socket(AF_INET, SOCK_STREAM, 0);
+			sockaddr_in addr{};
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t len = sizeof(addr);
+			if (bind(m_fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || listen(m_fd, 16) != 0 ||
+				getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+				throw std::runtime_error("failed to create server socket");
+			m_port = ntohs(addr.sin_port);
+			m_thread = std::thread([this, delay]() {
+				while (true) {
+					int client = accept(m_fd, nullptr, nullptr);
+					if (client < 0) break;
+					m_connections++;
+					std::thread([client, delay]() {
+						std::string req;
+						char buf[512];
+						while (true) {
+							auto n = read(client, buf, sizeof(buf));
+							if (n <= 0) break;
+							req.append(buf, n);
+							for (auto pos = req.find("\r\n\r\n"); pos != std::string::npos; pos = req.find("\r\n\r\n")) {
+								req.erase(0, pos + 4);
+								std::this_thread::sleep_for(delay);
+								std::string resp = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+								auto unused = write(client, resp.data(), resp.size());
+								static_cast<void>(unused);
+							}
+						}
+						close(client);
+					}).detach();
+				}
+			});
+		}
+		~keep_alive_server() {
+			shutdown(m_fd, SHUT_RDWR);
+			close(m_fd);
+			m_thread.join();
+		}
+		keep_alive_server(const keep_alive_server&) = delete;
+		keep_alive_server& operator=(const keep_alive_server&) = delete;
+
+		size_t connections() const noexcept { return m_connections; }
+		std::string host() const { return "127.0.0.1:" + std::to_string(m_port); }
+		std::string url() const { return "http://" + host() + "/"; }
+	};
+#endif
+} // namespace
+
+TEST(ASYNCPP_CURL, ExecutorPush) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode}};
+		std::promise<std::thread::id> promise;
+		exec.push([&promise]() { promise.set_value(std::this_thread::get_id()); });
+		ASSERT_NE(promise.get_future().get(), std::this_thread::get_id());
+	}
+}
+
+TEST(ASYNCPP_CURL, ExecutorWakeupCoalescing) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode}};
+		std::promise<void> blocked;
+		std::promise<void> done;
+		auto release = blocked.get_future();
+		exec.push([&release]() { release.wait(); });
+		// The executor is busy, so none of these should need a wakeup
+		std::atomic<size_t> count{0};
+		for (size_t i = 0; i < 1000; i++)
+			exec.push([&count]() { count++; });
+		exec.push([&done]() { done.set_value(); });
+		blocked.set_value();
+		done.get_future().get();
+		ASSERT_EQ(count, 1000);
+		ASSERT_LE(exec.num_wakeups(), 2);
+		ASSERT_GE(exec.num_coalesced_wakeups(), 999);
+	}
+}
+
+TEST(ASYNCPP_CURL, ExecutorStats) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode}};
+		std::promise<void> blocked;
+		auto release = blocked.get_future();
+		exec.push([&release]() { release.wait(); });
+		for (size_t i = 0; i < 100; i++)
+			exec.push([]() { std::this_thread::sleep_for(std::chrono::microseconds(10)); });
+		blocked.set_value();
+		// Statistics are published at the start of the next loop iteration
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		executor::statistics stats;
+		do {
+			exec.wakeup();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			stats = exec.stats();
+		} while (std::accumulate(stats.task_delay.begin(), stats.task_delay.end(), uint64_t{0}) < 101 && std::chrono::steady_clock::now() < deadline);
+		ASSERT_EQ(std::accumulate(stats.task_delay.begin(), stats.task_delay.end(), uint64_t{0}), 101);
+		ASSERT_GT(stats.loop_iterations, 0);
+		ASSERT_GE(stats.task_time, std::chrono::milliseconds(1));
+		ASSERT_GE(stats.queue_high_water, 1);
+		ASSERT_EQ(stats.running_transfers, 0);
+		ASSERT_EQ(stats.connect_only_handles, 0);
+	}
+}
+
+TEST(ASYNCPP_CURL, ExecutorEmbedded) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode, .start_thread = false}};
+		bool ran = false;
+		exec.push([&ran]() { ran = true; });
+		ASSERT_FALSE(ran);
+		ASSERT_TRUE(exec.run_once());
+		ASSERT_TRUE(ran);
+
+		// Tasks pushed by other threads have to wake a blocking run_once()
+		std::atomic<bool> remote{false};
+		std::thread producer([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			exec.push([&remote]() { remote = true; });
+		});
+		auto wait_start = std::chrono::steady_clock::now();
+		ASSERT_TRUE(exec.run_once(std::chrono::seconds(5)));
+		// The task that woke us up runs before run_once() returns
+		ASSERT_TRUE(remote);
+		ASSERT_LT(std::chrono::steady_clock::now() - wait_start, std::chrono::seconds(1));
+		producer.join();
+		// Returns right away once work was done instead of waiting for the timeout
+		exec.push([]() {});
+		wait_start = std::chrono::steady_clock::now();
+		ASSERT_TRUE(exec.run_once(std::chrono::seconds(5)));
+		ASSERT_LT(std::chrono::steady_clock::now() - wait_start, std::chrono::seconds(1));
+
+		std::stop_source stop;
+		auto start = std::chrono::steady_clock::now();
+		exec.schedule([&stop]() { stop.request_stop(); }, std::chrono::milliseconds(50));
+		exec.run_until(stop.get_token());
+		ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+		// Stopping from another thread
+		std::stop_source remote_stop;
+		std::thread stopper([&remote_stop]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			remote_stop.request_stop();
+		});
+		exec.run_until(remote_stop.get_token());
+		stopper.join();
+	}
+	executor threaded{};
+	ASSERT_THROW(threaded.run_once(), std::logic_error);
+}
+
+TEST(ASYNCPP_CURL, ExecutorEmbeddedBeforeRun) {
+	// Synchronous calls made by the constructing thread before the first run_once() must not wait for it
+	executor exec{executor::options{.start_thread = false}};
+	bool ran = false;
+	exec.push_wait([&ran]() { ran = true; });
+	ASSERT_TRUE(ran);
+	handle hdl;
+	hdl.set_url("http://localhost:1/");
+	exec.add_handle(hdl);
+	exec.remove_handle(hdl);
+	// Another thread can take over driving the executor
+	std::thread([&exec, &ran]() {
+		exec.push([&ran]() { ran = false; });
+		exec.run_once();
+	}).join();
+	ASSERT_FALSE(ran);
+}
+
+TEST(ASYNCPP_CURL, ExecutorBusyPoll) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode, .busy_poll = std::chrono::seconds(5)}};
+		exec.push_wait([]() {});
+		auto wakeups = exec.num_wakeups();
+		// Every task counts as activity, so the executor keeps spinning and never needs a wakeup
+		for (int i = 0; i < 50; i++) {
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+			exec.push_wait([]() {});
+		}
+		ASSERT_EQ(exec.num_wakeups(), wakeups);
+	}
+}
+
+TEST(ASYNCPP_CURL, ExecutorPriority) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode, .urgent_burst = 2}};
+		std::promise<void> started;
+		std::promise<void> blocked;
+		auto release = blocked.get_future();
+		exec.push([&started, &release]() {
+			started.set_value();
+			release.wait();
+		});
+		started.get_future().wait();
+		std::string order;
+		for (char c : std::string_view{"ab"})
+			exec.push([&order, c]() { order += c; });
+		for (char c : std::string_view{"VWXYZ"})
+			exec.push([&order, c]() { order += c; }, executor::task_priority::urgent);
+		blocked.set_value();
+		exec.push_wait([]() {});
+		// Urgent tasks go first, but a normal task gets a turn after every two of them
+		ASSERT_EQ(order, "VWaXYbZ");
+	}
+}
+
+#ifdef __linux__
+TEST(ASYNCPP_CURL, ExecutorDrain) {
+	// One server answers after a short delay, the other one never accepts the connection
+	auto listen_local = []() {
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t len = sizeof(addr);
+		if (bind(fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || listen(fd, 1) != 0 ||
+			getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+			throw std::runtime_error("failed to create server socket");
+		return std::make_pair(fd, "http://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/");
+	};
+	auto [slow_fd, slow_url] = listen_local();
+	auto [stuck_fd, stuck_url] = listen_local();
+	std::thread slow_server([fd = slow_fd]() {
+		int client = accept(fd, nullptr, nullptr);
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		char buf[512];
+		auto unused = read(client, buf, sizeof(buf));
+		std::string resp = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		unused = write(client, resp.data(), resp.size());
+		static_cast<void>(unused);
+		close(client);
+	});
+
+	executor exec;
+	handle slow, stuck, late;
+	slow.set_url(slow_url);
+	stuck.set_url(stuck_url);
+	late.set_url(slow_url);
+	auto run = [](executor& exec, handle& hdl) -> task<int> { co_return co_await exec.exec(hdl); };
+	auto slow_res = as_promise(run(exec, slow));
+	auto stuck_res = as_promise(run(exec, stuck));
+	// Make sure both transfers are added before draining
+	while (exec.num_handles() != 2)
+		std::this_thread::yield();
+	auto res = exec.drain(std::chrono::steady_clock::now() + std::chrono::milliseconds(500));
+	ASSERT_EQ(res.finished, 1);
+	ASSERT_EQ(res.aborted, 1);
+	ASSERT_EQ(slow_res.get(), CURLE_OK);
+	ASSERT_EQ(stuck_res.get(), CURLE_ABORTED_BY_CALLBACK);
+	ASSERT_EQ(exec.num_handles(), 0);
+	// Draining is terminal, new transfers are rejected and the executor can not be drained again
+	ASSERT_EQ(as_promise(run(exec, late)).get(), CURLE_FAILED_INIT);
+	ASSERT_THROW(exec.drain(std::chrono::steady_clock::now()), std::logic_error);
+	slow_server.join();
+	close(slow_fd);
+	close(stuck_fd);
+}
+
+TEST(ASYNCPP_CURL, ExecutorConnectionLimit) {
+	// Parallel transfers have to queue up for the single allowed connection
+	keep_alive_server server{std::chrono::milliseconds(20)};
+	{
+		executor exec{executor::options{.max_host_connections = 1, .max_total_connections = 1}};
+		handle hdls[3];
+		std::vector<std::future<int>> results;
+		auto run = [](executor& exec, handle& hdl) -> task<int> { co_return co_await exec.exec(hdl); };
+		for (auto& hdl : hdls) {
+			hdl.set_url(server.url());
+			results.push_back(as_promise(run(exec, hdl)));
+		}
+		for (auto& e : results)
+			ASSERT_EQ(e.get(), CURLE_OK);
+	}
+	ASSERT_EQ(server.connections(), 1);
+}
+
+TEST(ASYNCPP_CURL, ExecutorHostLimit) {
+	keep_alive_server server{std::chrono::milliseconds(50)};
+	executor exec{executor::options{.max_host_transfers = 1}};
+	handle hdls[3];
+	std::vector<std::future<int>> results;
+	auto run = [](executor& exec, handle& hdl) -> task<int> { co_return co_await exec.exec(hdl); };
+	for (auto& hdl : hdls) {
+		hdl.set_url(server.url());
+		results.push_back(as_promise(run(exec, hdl)));
+	}
+	for (auto& e : results)
+		ASSERT_EQ(e.get(), CURLE_OK);
+	// Transfers are started one after another in FIFO order, so they share a single connection
+	ASSERT_EQ(server.connections(), 1);
+	ASSERT_EQ(hdls[0].get_queue_time().count(), 0);
+	ASSERT_GE(hdls[1].get_queue_time(), std::chrono::milliseconds(40));
+	ASSERT_GE(hdls[2].get_queue_time(), hdls[1].get_queue_time() + std::chrono::milliseconds(40));
+}
+
+TEST(ASYNCPP_CURL, ExecutorRateLimit) {
+	keep_alive_server server{std::chrono::milliseconds(0)};
+	// One token every 200ms, far more than the scheduling noise of a busy test machine
+	auto limiter = std::make_shared<rate_limiter>(5, 1);
+	executor exec{executor::options{.host_rate_limits = {{server.host(), limiter}}}};
+	handle hdls[3];
+	std::chrono::steady_clock::time_point started[3]{};
+	std::vector<std::future<int>> results;
+	auto run = [](executor& exec, handle& hdl) -> task<int> { co_return co_await exec.exec(hdl); };
+	for (size_t i = 0; i < 3; i++) {
+		hdls[i].set_url(server.url());
+		hdls[i].set_progressfunction([&start = started[i]](int64_t, int64_t, int64_t, int64_t) {
+			if (start == std::chrono::steady_clock::time_point{}) start = std::chrono::steady_clock::now();
+			return 0;
+		});
+		results.push_back(as_promise(run(exec, hdls[i])));
+	}
+	// Waiting transfers do not block the executor thread
+	auto start = std::chrono::steady_clock::now();
+	exec.push_wait([]() {});
+	ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+	for (auto& e : results)
+		ASSERT_EQ(e.get(), CURLE_OK);
+	ASSERT_EQ(hdls[0].get_queue_time().count(), 0);
+	ASSERT_GT(hdls[1].get_queue_time().count(), 0);
+	ASSERT_GT(hdls[2].get_queue_time().count(), 0);
+	// Consecutive transfers start one token interval apart
+	ASSERT_GE(started[1] - started[0], std::chrono::milliseconds(150));
+	ASSERT_GE(started[2] - started[1], std::chrono::milliseconds(150));
+	ASSERT_EQ(limiter->stats().delayed, 2);
+}
+
+TEST(ASYNCPP_CURL, ExecutorRateLimitCancel) {
+	keep_alive_server server{std::chrono::milliseconds(0)};
+	auto limiter = std::make_shared<rate_limiter>(1, 1);
+	executor exec{executor::options{.host_rate_limits = {{server.host(), limiter}}}};
+	handle first, second;
+	first.set_url(server.url());
+	second.set_url(server.url());
+	exec.push_wait([&]() {
+		exec.add_handle(first);
+		exec.add_handle(second);
+	});
+	ASSERT_LT(limiter->tokens(), -0.5);
+	// Removing the delayed transfer before it started gives its token back
+	exec.remove_handle(second);
+	ASSERT_GT(limiter->tokens(), -0.5);
+	ASSERT_EQ(limiter->stats().acquired, 1);
+	exec.remove_handle(first);
+}
+
+TEST(ASYNCPP_CURL, ExecutorThreadOptions) {
+	cpu_set_t allowed;
+	ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+	size_t cpu = 0;
+	while (!CPU_ISSET(cpu, &allowed))
+		cpu++;
+	executor exec{executor::options{.cpu_affinity = {cpu}, .thread_name = "curl-test"}};
+	exec.push_wait([cpu]() {
+		cpu_set_t set;
+		ASSERT_EQ(sched_getaffinity(0, sizeof(set), &set), 0);
+		ASSERT_EQ(CPU_COUNT(&set), 1);
+		ASSERT_TRUE(CPU_ISSET(cpu, &set));
+		char name[16]{};
+		ASSERT_EQ(pthread_getname_np(pthread_self(), name, sizeof(name)), 0);
+		ASSERT_STREQ(name, "curl-test");
+	});
+	ASSERT_THROW(executor{executor::options{.cpu_affinity = {CPU_SETSIZE}}}, std::invalid_argument);
+}
+#endif
+
+TEST(ASYNCPP_CURL, ExecutorHandleAsync) {
+	executor exec;
+	handle hdl;
+	hdl.set_option_bool(CURLOPT_CONNECT_ONLY, true);
+	as_promise([](executor& exec, handle& hdl) -> task<void> {
+		co_await exec.add_handle_async(hdl);
+		EXPECT_EQ(exec.num_handles(), 1);
+		co_await exec.remove_handle_async(hdl);
+		EXPECT_EQ(exec.num_handles(), 0);
+	}(exec, hdl))
+		.get();
+}
+
+TEST(ASYNCPP_CURL, ExecutorAddHandleNowaitFailure) {
+	executor exec;
+	multi other;
+	handle hdl;
+	other.add_handle(hdl);
+	std::promise<int> result;
+	hdl.set_donefunction([&result](int res) { result.set_value(res); });
+	exec.add_handle_nowait(hdl);
+	ASSERT_EQ(result.get_future().get(), CURLE_FAILED_INIT);
+	ASSERT_EQ(exec.num_handles(), 0);
+	other.remove_handle(hdl);
+}
+
+TEST(ASYNCPP_CURL, ExecutorSchedule) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode}};
+		std::promise<void> promise;
+		auto start = std::chrono::steady_clock::now();
+		exec.schedule([&promise]() { promise.set_value(); }, std::chrono::milliseconds(200));
+		promise.get_future().get();
+		ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+	}
+}
+
+TEST(ASYNCPP_CURL, ExecutorScheduleCancel) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode}};
+		std::atomic<bool> cancelled_ran{false};
+		std::promise<void> promise;
+		auto hdl = exec.schedule([&cancelled_ran]() { cancelled_ran = true; }, std::chrono::milliseconds(50));
+		exec.schedule([&promise]() { promise.set_value(); }, std::chrono::milliseconds(100));
+		ASSERT_TRUE(hdl.valid());
+		ASSERT_TRUE(hdl.cancel());
+		ASSERT_FALSE(hdl.cancel());
+		promise.get_future().get();
+		ASSERT_FALSE(cancelled_ran);
+	}
+}
+
+TEST(ASYNCPP_CURL, ExecutorSleep) {
+	for (auto mode : loop_modes) {
+		executor exec{executor::options{.mode = mode}};
+		auto [elapsed, thread] = as_promise([](executor& exec) -> task<std::pair<std::chrono::steady_clock::duration, std::thread::id>> {
+									 auto start = std::chrono::steady_clock::now();
+									 co_await exec.sleep_for(std::chrono::microseconds(1500));
+									 co_return std::make_pair(std::chrono::steady_clock::now() - start, std::this_thread::get_id());
+								 }(exec))
+									 .get();
+		ASSERT_GE(elapsed, std::chrono::microseconds(1500));
+		ASSERT_NE(thread, std::this_thread::get_id());
+	}
+}
+
+TEST(ASYNCPP_CURL, ExecutorPoolRoundRobin) {
+	executor_pool pool{executor_pool::options{.size = 3}};
+	ASSERT_EQ(pool.size(), 3);
+	ASSERT_EQ(&pool.get(), &pool[0]);
+	ASSERT_EQ(&pool.get(), &pool[1]);
+	ASSERT_EQ(&pool.get(), &pool[2]);
+	ASSERT_EQ(&pool.get(), &pool[0]);
+}
+
+TEST(ASYNCPP_CURL, ExecutorPoolHostHash) {
+	executor_pool pool{executor_pool::options{.size = 4, .policy = executor_pool::placement::host_hash}};
+	auto& exec = pool.get("example.com");
+	for (size_t i = 0; i < 10; i++) {
+		ASSERT_EQ(&pool.get("example.com"), &exec);
+	}
+}
+
+TEST(ASYNCPP_CURL, ExecutorPoolLeastLoaded) {
+	executor_pool pool{executor_pool::options{.size = 2, .policy = executor_pool::placement::least_loaded}};
+	for (size_t i = 0; i < 4; i++) {
+		ASSERT_EQ(pool.get().num_handles(), 0);
+	}
+}
+
+#ifdef __linux__
+TEST(ASYNCPP_CURL, ExecutorPoolPinThreads) {
+	executor::options exec_opts{};
+	exec_opts.thread_name = "pool";
+	executor_pool pool{executor_pool::options{.size = 2, .executor_options = exec_opts, .pin_threads = true}};
+	for (size_t i = 0; i < pool.size(); i++) {
+		pool[i].push_wait([i]() {
+			cpu_set_t set;
+			ASSERT_EQ(sched_getaffinity(0, sizeof(set), &set), 0);
+			ASSERT_EQ(CPU_COUNT(&set), 1);
+			char name[16]{};
+			ASSERT_EQ(pthread_getname_np(pthread_self(), name, sizeof(name)), 0);
+			ASSERT_EQ(std::string(name), "pool-" + std::to_string(i));
+		});
+	}
+}
+#endif
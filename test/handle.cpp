@@ -0,0 +1,138 @@
+#include <asyncpp/curl/exception.h>
+#include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/handle.h>
+#include <curl/curl.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+
+using namespace asyncpp::curl;
+
+namespace {
+	// Local file used as transfer source, so the tests do not depend on network access.
+	// The name includes the test, so tests running in parallel do not overwrite each others file.
+	struct temp_file {
+		std::filesystem::path path;
+		explicit temp_file(const std::string& content)
+			: path{std::filesystem::temp_directory_path() /
+				   (std::string{"asyncpp_curl_"} + ::testing::UnitTest::GetInstance()->current_test_info()->name())} {
+			std::ofstream{path, std::ios::binary} << content;
+		}
+		~temp_file() { std::filesystem::remove(path); }
+		std::string url() const { return "file://" + path.string(); }
+	};
+} // namespace
+
+TEST(ASYNCPP_CURL, HandleWriteFunction) {
+	const std::string content(100000, 'x');
+	temp_file file{content};
+	handle hdl;
+	hdl.set_url(file.url());
+	hdl.set_option_long(CURLOPT_BUFFERSIZE, 1024);
+	// Templated overload with a mutable lambda
+	std::string received;
+	size_t calls = 0;
+	hdl.set_writefunction([&received, calls_ref = &calls, counter = size_t{0}](char* ptr, size_t size) mutable {
+		received.append(ptr, size);
+		*calls_ref = ++counter;
+		return size;
+	});
+	hdl.perform();
+	ASSERT_EQ(received, content);
+	ASSERT_GT(calls, 1);
+	// std::function overload
+	received.clear();
+	std::function<size_t(char*, size_t)> fn = [&received](char* ptr, size_t size) {
+		received.append(ptr, size);
+		return size;
+	};
+	hdl.set_writefunction(fn);
+	hdl.perform();
+	ASSERT_EQ(received, content);
+	// Returning less than size aborts the transfer
+	hdl.set_writefunction([](char*, size_t) -> size_t { return 0; });
+	ASSERT_THROW(hdl.perform(), exception);
+	// Null function pointers are rejected instead of crashing in the trampoline
+	size_t (*null_fn)(char*, size_t) = nullptr;
+	ASSERT_THROW(hdl.set_writefunction(null_fn), std::invalid_argument);
+	ASSERT_THROW(hdl.set_readfunction(null_fn), std::invalid_argument);
+}
+
+TEST(ASYNCPP_CURL, HandleTypedOptions) {
+	static_assert(option_traits<CURLOPT_TIMEOUT_MS>::kind == option_kind::long_value);
+	static_assert(option_traits<CURLOPT_URL>::kind == option_kind::pointer);
+	static_assert(option_traits<CURLOPT_HTTPHEADER>::kind == option_kind::pointer);
+	static_assert(option_traits<CURLOPT_WRITEFUNCTION>::kind == option_kind::function);
+	static_assert(option_traits<CURLOPT_INFILESIZE_LARGE>::kind == option_kind::offset);
+	static_assert(option_traits<CURLOPT_URL>::copies_string);
+	static_assert(option_traits<CURLOPT_COPYPOSTFIELDS>::copies_string);
+	static_assert(!option_traits<CURLOPT_POSTFIELDS>::copies_string);
+	static_assert(!option_traits<CURLOPT_TIMEOUT_MS>::copies_string);
+	static_assert(!option_traits<CURLOPT_PRIVATE>::copies_string);
+	static_assert(!option_traits<CURLOPT_WRITEDATA>::copies_string);
+	static_assert(!option_traits<CURLOPT_HTTPHEADER>::copies_string);
+	static_assert(option_traits<CURLOPT_URL>::pointer == pointer_kind::string);
+	static_assert(option_traits<CURLOPT_HTTPHEADER>::pointer == pointer_kind::slist);
+	static_assert(option_traits<CURLOPT_SHARE>::pointer == pointer_kind::object);
+	static_assert(option_traits<CURLOPT_POSTFIELDS>::pointer == pointer_kind::buffer);
+	static_assert(option_traits<CURLOPT_TIMEOUT_MS>::pointer == pointer_kind::none);
+
+	temp_file file{"Hello"};
+	handle hdl;
+	std::string received;
+	hdl.set<CURLOPT_URL>(file.url());
+	hdl.set<CURLOPT_TIMEOUT_MS>(std::chrono::milliseconds(5000).count());
+	hdl.set<CURLOPT_MAXFILESIZE_LARGE>(1024);
+	hdl.set<CURLOPT_VERBOSE>(true);
+	ASSERT_TRUE(hdl.is_verbose());
+	hdl.set<CURLOPT_VERBOSE>(false);
+	ASSERT_FALSE(hdl.is_verbose());
+	// nullptr clears slist options
+	hdl.set<CURLOPT_HTTPHEADER>(nullptr);
+	hdl.set_writestring(received);
+	hdl.perform();
+	ASSERT_EQ(received, "Hello");
+	hdl.set<CURLOPT_CONNECT_ONLY>(1);
+	ASSERT_TRUE(hdl.is_connect_only());
+}
+
+TEST(ASYNCPP_CURL, HandleExecutorOwned) {
+	temp_file file{"Hello"};
+	executor exec;
+	handle hdl;
+	std::string received;
+	std::promise<long> done;
+	exec.push_wait([&]() {
+		hdl.set_owner(&exec);
+		hdl.set_url(file.url());
+		hdl.set_writestring(received);
+		hdl.set_donefunction([&](int result) {
+			// Done callbacks run on the executor thread, so the bound handle can be used without locking
+			done.set_value(result == CURLE_OK ? hdl.get_response_code() : -1);
+		});
+		exec.add_handle(hdl);
+	});
+	ASSERT_EQ(done.get_future().get(), 0);
+	ASSERT_EQ(received, "Hello");
+	ASSERT_EQ(hdl.get_owner(), &exec);
+	// Unbinding switches back to locking, after which the handle can be used from any thread
+	exec.push_wait([&]() { hdl.set_owner(nullptr); });
+	ASSERT_EQ(hdl.get_owner(), nullptr);
+	received.clear();
+	hdl.perform();
+	ASSERT_EQ(received, "Hello");
+	// Binding has to happen on the executor thread and only the bound thread can unbind
+	ASSERT_THROW(hdl.set_owner(&exec), std::logic_error);
+	exec.push_wait([&]() { hdl.set_owner(&exec); });
+	ASSERT_THROW(hdl.set_owner(nullptr), std::logic_error);
+	// reset() clears the binding
+	exec.push_wait([&]() { hdl.reset(); });
+	ASSERT_EQ(hdl.get_owner(), nullptr);
+}
@@ -0,0 +1,51 @@
+#include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/handle_pool.h>
+#include <asyncpp/curl/slist.h>
+#include <curl/curl.h>
+#include <gtest/gtest.h>
+
+using namespace asyncpp::curl;
+
+TEST(ASYNCPP_CURL, HandlePoolReuse) {
+	handle_pool pool{};
+	auto hdl = pool.acquire();
+	auto ptr = hdl.get();
+	ASSERT_EQ(pool.idle(), 0);
+	hdl.reset();
+	ASSERT_EQ(pool.idle(), 1);
+	hdl = pool.acquire();
+	ASSERT_EQ(hdl.get(), ptr);
+	ASSERT_EQ(pool.idle(), 0);
+}
+
+TEST(ASYNCPP_CURL, HandlePoolMaxIdle) {
+	handle_pool pool{2};
+	{
+		auto a = pool.acquire();
+		auto b = pool.acquire();
+		auto c = pool.acquire();
+	}
+	ASSERT_EQ(pool.idle(), 2);
+}
+
+TEST(ASYNCPP_CURL, HandlePoolClearsCookies) {
+	handle_pool pool{};
+	auto hdl = pool.acquire();
+	hdl->set_option_string(CURLOPT_COOKIELIST, "Set-Cookie: name=value; domain=example.com");
+	ASSERT_FALSE(hdl->get_info_slist(CURLINFO_COOKIELIST).empty());
+	hdl.reset();
+	hdl = pool.acquire();
+	ASSERT_TRUE(hdl->get_info_slist(CURLINFO_COOKIELIST).empty());
+}
+
+TEST(ASYNCPP_CURL, HandlePoolClearsOwner) {
+	handle_pool pool{};
+	executor exec;
+	auto hdl = pool.acquire();
+	exec.push_wait([&]() { hdl->set_owner(&exec); });
+	// Releasing a bound handle from a different thread is fine, since nobody uses it anymore
+	hdl.reset();
+	hdl = pool.acquire();
+	ASSERT_EQ(hdl->get_owner(), nullptr);
+}
@@ -0,0 +1,189 @@
+#include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/handle_template.h>
+#include <asyncpp/curl/slist.h>
+#include <asyncpp/curl/webclient.h>
+#include <curl/curl.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace asyncpp::curl;
+
+#ifdef __linux__
+namespace {
+	// Minimal http server that responds with the received request head as body and sets a cookie
+	slist make_headers(const char* header) {
+		slist res;
+		res.append(header);
+		return res;
+	}
+
+	class echo_server {
+		int m_fd;
+		uint16_t m_port;
+		std::thread m_thread;
+
+	public:
+		echo_server() {
+			m_fd = socket(AF_INET, SOCK_STREAM, 0);
+			sockaddr_in addr{};
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t len = sizeof(addr);
+			if (bind(m_fd, reinterpret_cast<sockaddr*>(&addr), len) != 0 || listen(m_fd, 16) != 0 ||
+				getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+				throw std::runtime_error("failed to create server socket");
+			m_port = ntohs(addr.sin_port);
+			m_thread = std::thread([this]() {
+				while (true) {
+					int client = accept(m_fd, nullptr, nullptr);
+					if (client < 0) break;
+					std::string req;
+					char buf[512];
+					while (req.find("\r\n\r\n") == std::string::npos) {
+						auto n = read(client, buf, sizeof(buf));
+						if (n <= 0) break;
+						req.append(buf, n);
+					}
+					std::string resp = "HTTP/1.1 200 OK\r\nConnection: close\r\nSet-Cookie: seen=1\r\nContent-Length: " + std::to_string(req.size()) + "\r\n\r\n" + req;
+					auto unused = write(client, resp.data(), resp.size());
+					static_cast<void>(unused);
+					close(client);
+				}
+			});
+		}
+		~echo_server() {
+			shutdown(m_fd, SHUT_RDWR);
+			close(m_fd);
+			m_thread.join();
+		}
+		echo_server(const echo_server&) = delete;
+		echo_server& operator=(const echo_server&) = delete;
+
+		std::string url() const { return "http://127.0.0.1:" + std::to_string(m_port) + "/"; }
+	};
+} // namespace
+
+TEST(ASYNCPP_CURL, HandleTemplateDuplicate) {
+	echo_server server;
+	handle_template tmpl;
+	size_t template_headers = 0;
+	size_t copy_headers = 0;
+	tmpl.prototype().set_url(server.url());
+	tmpl.prototype().set_headers(make_headers("X-Template: 1"));
+	tmpl.prototype().set_headerfunction([&copy_headers](char*, size_t size) {
+		copy_headers++;
+		return size;
+	});
+	auto hdl = tmpl.make();
+	// Changing the prototype afterwards does not affect existing copies
+	tmpl.prototype().set_headers(make_headers("X-Template: 2"));
+	tmpl.prototype().set_headerfunction([&template_headers](char*, size_t size) {
+		template_headers++;
+		return size;
+	});
+	std::string received;
+	hdl->set_writestring(received);
+	hdl->perform();
+	ASSERT_EQ(hdl->get_response_code(), 200);
+	ASSERT_NE(received.find("X-Template: 1\r\n"), std::string::npos);
+	ASSERT_GT(copy_headers, 0);
+	ASSERT_EQ(template_headers, 0);
+	// Copies start without a write callback, just like a new handle
+	auto other = tmpl.make();
+	received.clear();
+	other->set_writestring(received);
+	other->perform();
+	ASSERT_NE(received.find("X-Template: 2\r\n"), std::string::npos);
+	ASSERT_GT(template_headers, 0);
+	// The done callback is not copied, otherwise finishing the copy would resume whoever waits for the prototype
+	std::atomic<size_t> done_calls{0};
+	tmpl.prototype().set_donefunction([&done_calls](int) { done_calls++; });
+	auto copy = tmpl.make();
+	copy->set_writestring(received);
+	executor exec;
+	exec.add_handle(*copy);
+	// The transfer might finish before drain() is called, so only check that it was not aborted
+	ASSERT_EQ(exec.drain(std::chrono::steady_clock::now() + std::chrono::seconds(5)).aborted, 0);
+	ASSERT_EQ(copy->get_response_code(), 200);
+	ASSERT_EQ(done_calls, 0);
+}
+
+TEST(ASYNCPP_CURL, HandleTemplateRequest) {
+	echo_server server;
+	auto base = http_request::make_get(uri{server.url()});
+	base.headers.emplace("X-Base", "1");
+	base.timeout = std::chrono::seconds(10);
+	auto tmpl = std::make_shared<handle_template>(base);
+	ASSERT_NE(tmpl->base(), nullptr);
+	ASSERT_EQ(tmpl->base()->headers, base.headers);
+
+	auto req = base;
+	req.base_template = tmpl;
+	auto resp = req.execute_sync();
+	ASSERT_EQ(resp.status_code, 200);
+	ASSERT_TRUE(resp.body.starts_with("GET / HTTP/1.1\r\n"));
+	ASSERT_NE(resp.body.find("X-Base: 1\r\n"), std::string::npos);
+	// Fields differing from the base request are applied on top of the template
+	req.request_method = "DELETE";
+	req.headers.emplace("X-Request", "2");
+	req.url = uri{server.url() + "path"};
+	resp = req.execute_sync();
+	ASSERT_EQ(resp.status_code, 200);
+	ASSERT_TRUE(resp.body.starts_with("DELETE /path HTTP/1.1\r\n"));
+	ASSERT_NE(resp.body.find("X-Base: 1\r\n"), std::string::npos);
+	ASSERT_NE(resp.body.find("X-Request: 2\r\n"), std::string::npos);
+	// The template itself is unchanged
+	req = base;
+	req.base_template = tmpl;
+	resp = req.execute_sync();
+	ASSERT_TRUE(resp.body.starts_with("GET / HTTP/1.1\r\n"));
+	ASSERT_EQ(resp.body.find("X-Request"), std::string::npos);
+}
+
+TEST(ASYNCPP_CURL, HandleTemplateCookies) {
+	echo_server server;
+	// Requests using a template get the same cookie handling as pooled handles, even if the template is not made from a request
+	for (auto tmpl : {std::make_shared<handle_template>(), std::make_shared<handle_template>(http_request::make_get(uri{server.url()}))}) {
+		auto req = http_request::make_get(uri{server.url()});
+		req.base_template = tmpl;
+		auto resp = req.execute_sync();
+		ASSERT_EQ(resp.status_code, 200);
+		// Cookies set by the server are only recorded if the cookie engine is enabled
+		ASSERT_EQ(resp.cookies.size(), 1);
+	}
+}
+
+TEST(ASYNCPP_CURL, HandleTemplateAuth) {
+	echo_server server;
+	auto base = http_request::make_get(uri{server.url()});
+	base.url.auth(std::string{"user:pass"});
+	auto tmpl = std::make_shared<handle_template>(base);
+
+	auto req = base;
+	req.base_template = tmpl;
+	auto resp = req.execute_sync();
+	ASSERT_NE(resp.body.find("Authorization: Basic dXNlcjpwYXNz\r\n"), std::string::npos);
+	// Removing the credentials of the template has to behave like a fresh handle
+	req.url.auth(std::string{});
+	resp = req.execute_sync();
+	ASSERT_EQ(resp.status_code, 200);
+	ASSERT_EQ(resp.body.find("Authorization"), std::string::npos);
+	// A username without password replaces both
+	req.url.auth(std::string{"other"});
+	resp = req.execute_sync();
+	ASSERT_NE(resp.body.find("Authorization: Basic b3RoZXI6\r\n"), std::string::npos);
+}
+#endif
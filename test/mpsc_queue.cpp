@@ -0,0 +1,46 @@
+#include <asyncpp/curl/mpsc_queue.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace asyncpp::curl;
+
+TEST(ASYNCPP_CURL, MpscQueueOverflow) {
+	mpsc_queue<int> queue{4};
+	for (int i = 0; i < 10; i++)
+		ASSERT_EQ(queue.push(i), i < 4);
+	// Overflow is used till drained, even if the ring has room again
+	ASSERT_EQ(queue.pop(), 0);
+	ASSERT_FALSE(queue.push(10));
+	for (int i = 1; i <= 10; i++)
+		ASSERT_EQ(queue.pop(), i);
+	ASSERT_FALSE(queue.pop().has_value());
+	ASSERT_TRUE(queue.push(11));
+	ASSERT_EQ(queue.pop(), 11);
+}
+
+TEST(ASYNCPP_CURL, MpscQueueMultiProducer) {
+	constexpr int num_threads = 4;
+	constexpr int num_elements = 20000;
+	mpsc_queue<std::pair<int, int>> queue{64};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; t++) {
+		threads.emplace_back([&queue, t]() {
+			for (int i = 0; i < num_elements; i++)
+				queue.emplace(t, i);
+		});
+	}
+	std::vector<int> next(num_threads, 0);
+	for (int received = 0; received < num_threads * num_elements;) {
+		auto e = queue.pop();
+		if (!e) continue;
+		// Elements from the same producer need to stay in order
+		ASSERT_EQ(e->second, next[e->first]);
+		next[e->first]++;
+		received++;
+	}
+	for (auto& t : threads)
+		t.join();
+	ASSERT_FALSE(queue.pop().has_value());
+}
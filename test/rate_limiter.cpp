@@ -0,0 +1,50 @@
+#include <asyncpp/curl/rate_limiter.h>
+#include <gtest/gtest.h>
+
+using namespace asyncpp::curl;
+using namespace std::chrono_literals;
+
+TEST(ASYNCPP_CURL, RateLimiterBurst) {
+	rate_limiter limiter{10, 3};
+	auto now = rate_limiter::clock::now();
+	for (size_t i = 0; i < 3; i++)
+		ASSERT_TRUE(limiter.try_acquire(now));
+	ASSERT_FALSE(limiter.try_acquire(now));
+	ASSERT_DOUBLE_EQ(limiter.tokens(now), 0);
+	// One token is added every 100ms
+	ASSERT_FALSE(limiter.try_acquire(now + 50ms));
+	ASSERT_TRUE(limiter.try_acquire(now + 100ms));
+	// The bucket never holds more than burst tokens
+	ASSERT_DOUBLE_EQ(limiter.tokens(now + 10s), 3);
+}
+
+TEST(ASYNCPP_CURL, RateLimiterReserve) {
+	rate_limiter limiter{10, 1};
+	auto now = rate_limiter::clock::now();
+	ASSERT_EQ(limiter.reserve(now), now);
+	// Reservations queue up behind each other
+	ASSERT_EQ(limiter.reserve(now), now + 100ms);
+	ASSERT_EQ(limiter.reserve(now), now + 200ms);
+	ASSERT_DOUBLE_EQ(limiter.tokens(now), -2);
+	auto stats = limiter.stats();
+	ASSERT_EQ(stats.acquired, 3);
+	ASSERT_EQ(stats.delayed, 2);
+	ASSERT_EQ(stats.total_wait, 300ms);
+	ASSERT_EQ(stats.max_wait, 200ms);
+	ASSERT_THROW(rate_limiter(0, 1), std::invalid_argument);
+}
+
+TEST(ASYNCPP_CURL, RateLimiterRelease) {
+	rate_limiter limiter{10, 1};
+	auto now = rate_limiter::clock::now();
+	ASSERT_EQ(limiter.reserve(now), now);
+	ASSERT_EQ(limiter.reserve(now), now + 100ms);
+	// A returned token shortens the wait of the next reservation
+	limiter.release(now);
+	ASSERT_DOUBLE_EQ(limiter.tokens(now), 0);
+	ASSERT_EQ(limiter.reserve(now), now + 100ms);
+	ASSERT_EQ(limiter.stats().acquired, 2);
+	// The bucket never holds more than burst tokens
+	limiter.release(now + 10s);
+	ASSERT_DOUBLE_EQ(limiter.tokens(now + 10s), 1);
+}
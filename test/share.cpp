@@ -0,0 +1,28 @@
+#include <asyncpp/curl/handle.h>
+#include <asyncpp/curl/share.h>
+
+#include <curl/curl.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+
+using namespace asyncpp::curl;
+
+TEST(ASYNCPP_CURL, ShareAttach) {
+	auto shared = std::make_shared<share>();
+	handle hdl;
+	hdl.set_share(shared);
+	ASSERT_EQ(hdl.get_share(), shared);
+	ASSERT_EQ(shared.use_count(), 2);
+	hdl.reset();
+	ASSERT_EQ(hdl.get_share(), nullptr);
+	ASSERT_EQ(shared.use_count(), 1);
+}
+
+TEST(ASYNCPP_CURL, ShareConnectOptIn) {
+	share shared;
+	// The connection cache is not shared by default, but can be enabled for single threaded use
+	ASSERT_NO_THROW(shared.set_shared(CURL_LOCK_DATA_CONNECT));
+	ASSERT_NO_THROW(shared.set_shared(CURL_LOCK_DATA_CONNECT, false));
+	ASSERT_THROW(shared.set_shared(CURL_LOCK_DATA_LAST), std::runtime_error);
+}
@@ -1,12 +1,23 @@
+#include <asyncpp/curl/executor.h>
+#include <asyncpp/curl/executor_pool.h>
 #include <asyncpp/curl/tcp_client.h>
 #include <asyncpp/launch.h>
 #include <asyncpp/sync_wait.h>
 #include <asyncpp/task.h>
 
 #include <chrono>
+#include <future>
 #include <gtest/gtest.h>
+#include <string>
 #include <thread>
 
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 using namespace asyncpp::curl;
 using namespace asyncpp;
 
@@ -81,3 +92,115 @@ TEST(ASYNCPP_CURL, TcpClientAsyncRead) {
 	}())
 		.get();
 }
+
+TEST(ASYNCPP_CURL, TcpClientPoolHost) {
+	executor_pool pool{executor_pool::options{.size = 4, .policy = executor_pool::placement::host_hash}};
+	// Clients for the same host end up on the same executor
+	tcp_client client{pool, "example.com"};
+	ASSERT_EQ(&client.get_executor(), &pool.get("example.com"));
+}
+
+#ifdef __linux__
+TEST(ASYNCPP_CURL, TcpClientLoopback) {
+	for (auto mode : {executor::loop_mode::poll, executor::loop_mode::socket_action}) {
+		// Local echo server, so this does not depend on network access
+		int server = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t len = sizeof(addr);
+		ASSERT_EQ(bind(server, reinterpret_cast<sockaddr*>(&addr), len), 0);
+		ASSERT_EQ(listen(server, 1), 0);
+		ASSERT_EQ(getsockname(server, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+		std::thread echo([server]() {
+			int client = accept(server, nullptr, nullptr);
+			char buf[128];
+			while (true) {
+				auto n = read(client, buf, sizeof(buf));
+				if (n <= 0 || write(client, buf, n) != n) break;
+			}
+			close(client);
+		});
+
+		executor exec{executor::options{.mode = mode}};
+		as_promise([](executor& exec, uint16_t port) -> task<void> {
+			tcp_client client{exec};
+			co_await client.connect("127.0.0.1", port, false);
+			for (int i = 0; i < 10; i++) {
+				std::string str = "Hello World " + std::to_string(i);
+				auto written = co_await client.send_all(str.data(), str.size());
+				COASSERT_EQ(written, str.size());
+				char buf[128]{};
+				auto read = co_await client.recv(buf, str.size());
+				COASSERT_EQ(std::string_view(buf, read), str);
+			}
+			co_await client.disconnect();
+		}(exec, ntohs(addr.sin_port)))
+			.get();
+		close(server);
+		echo.join();
+	}
+}
+
+TEST(ASYNCPP_CURL, TcpClientLoopbackOwned) {
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	ASSERT_EQ(bind(server, reinterpret_cast<sockaddr*>(&addr), len), 0);
+	ASSERT_EQ(listen(server, 1), 0);
+	ASSERT_EQ(getsockname(server, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+	std::thread echo([server]() {
+		int client = accept(server, nullptr, nullptr);
+		char buf[128];
+		while (true) {
+			auto n = read(client, buf, sizeof(buf));
+			if (n <= 0 || write(client, buf, n) != n) break;
+		}
+		close(client);
+	});
+
+	{
+		executor exec;
+		tcp_client client{exec};
+		const std::string str = "Hello World";
+		as_promise([](tcp_client& client, uint16_t port) -> task<void> { co_await client.connect("127.0.0.1", port, false); }(client, ntohs(addr.sin_port)))
+			.get();
+		// From now on the client is only used from the executor thread, so its handle can be bound to it
+		std::promise<size_t> sent;
+		exec.push_wait([&]() {
+			client.get_handle().set_owner(&exec);
+			client.send_all(str.data(), str.size(), [&sent](size_t written) { sent.set_value(written); });
+		});
+		ASSERT_EQ(sent.get_future().get(), str.size());
+		ASSERT_EQ(client.get_handle().get_owner(), &exec);
+
+		// Reading the echo through recv_raw() from the data callback uses the bound handle
+		std::string received;
+		std::promise<void> done;
+		exec.push_wait([&]() {
+			client.set_on_data_available([&](bool disconnected) {
+				if (disconnected) return tcp_client::callback_result::clear;
+				char buf[128];
+				auto n = client.recv_raw(buf, sizeof(buf));
+				if (n > 0) received.append(buf, n);
+				if (received.size() < str.size()) return tcp_client::callback_result::none;
+				done.set_value();
+				return tcp_client::callback_result::clear;
+			});
+			client.pause_receive(false);
+		});
+		done.get_future().get();
+		ASSERT_EQ(received, str);
+
+		// Disconnecting resets the handle, which also clears the binding
+		std::promise<void> disconnected;
+		exec.push_wait([&]() { client.disconnect([&]() { disconnected.set_value(); }); });
+		disconnected.get_future().get();
+		ASSERT_EQ(client.get_handle().get_owner(), nullptr);
+	}
+	close(server);
+	echo.join();
+}
+#endif
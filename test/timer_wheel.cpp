@@ -0,0 +1,61 @@
+#include <asyncpp/curl/timer_wheel.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+using namespace asyncpp::curl;
+using namespace std::chrono_literals;
+
+TEST(ASYNCPP_CURL, TimerWheelExpire) {
+	const auto start = timer_wheel::clock::now();
+	timer_wheel wheel{start};
+	std::vector<int> fired;
+	for (auto ms : {5000, 1, 70, 300000, 4100, 70}) {
+		wheel.insert(start + std::chrono::milliseconds(ms), [&fired, ms]() { fired.push_back(ms); });
+	}
+	ASSERT_EQ(wheel.size(), 6);
+
+	std::vector<std::function<void()>> expired;
+	// Nothing may fire before its deadline, including sub-millisecond differences
+	wheel.expire(start + 1ms - 1us, expired);
+	ASSERT_TRUE(expired.empty());
+	wheel.expire(start + 4100ms, expired);
+	for (auto& e : expired)
+		e();
+	ASSERT_EQ(fired, (std::vector<int>{1, 70, 70, 4100}));
+	expired.clear();
+	fired.clear();
+
+	ASSERT_EQ(wheel.size(), 2);
+	ASSERT_LE(wheel.next_expiry(), start + 5000ms);
+	wheel.expire(start + 1h, expired);
+	for (auto& e : expired)
+		e();
+	ASSERT_EQ(fired, (std::vector<int>{5000, 300000}));
+	ASSERT_TRUE(wheel.empty());
+	ASSERT_EQ(wheel.next_expiry(), timer_wheel::clock::time_point::max());
+}
+
+TEST(ASYNCPP_CURL, TimerWheelCancel) {
+	const auto start = timer_wheel::clock::now();
+	timer_wheel wheel{start};
+	auto a = wheel.insert(start + 10ms, []() {});
+	auto b = wheel.insert(start + 20ms, []() {});
+	ASSERT_TRUE(wheel.cancel(a));
+	ASSERT_FALSE(wheel.cancel(a));
+	ASSERT_EQ(wheel.size(), 1);
+	ASSERT_EQ(wheel.next_expiry(), start + 20ms);
+
+	// Reusing the slot of a cancelled timer must not revive the old id
+	auto c = wheel.insert(start + 30ms, []() {});
+	ASSERT_EQ(c.index, a.index);
+	ASSERT_FALSE(wheel.cancel(a));
+
+	std::vector<std::function<void()>> expired;
+	wheel.expire(start + 20ms, expired);
+	ASSERT_EQ(expired.size(), 1);
+	ASSERT_FALSE(wheel.cancel(b));
+	ASSERT_TRUE(wheel.cancel(c));
+	ASSERT_TRUE(wheel.empty());
+}
@@ -0,0 +1,39 @@
+#include <asyncpp/curl/unique_function.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+
+using namespace asyncpp::curl;
+
+TEST(ASYNCPP_CURL, UniqueFunctionInline) {
+	auto ptr = std::make_unique<int>(42);
+	unique_function<int(int)> fn = [ptr = std::move(ptr)](int x) { return *ptr + x; };
+	ASSERT_TRUE(fn);
+	ASSERT_EQ(fn(1), 43);
+	auto other = std::move(fn);
+	ASSERT_FALSE(fn);
+	ASSERT_EQ(other(2), 44);
+	other = nullptr;
+	ASSERT_FALSE(other);
+}
+
+TEST(ASYNCPP_CURL, UniqueFunctionHeap) {
+	auto counter = std::make_shared<int>(0);
+	std::array<char, 128> big{};
+	{
+		unique_function<void()> fn = [counter, big]() { (*counter) += big.size(); };
+		ASSERT_EQ(counter.use_count(), 2);
+		unique_function<void()> other;
+		other = std::move(fn);
+		other();
+		ASSERT_EQ(*counter, 128);
+	}
+	ASSERT_EQ(counter.use_count(), 1);
+}
+
+TEST(ASYNCPP_CURL, UniqueFunctionEmptyStdFunction) {
+	std::function<void()> empty;
+	unique_function<void()> fn = empty;
+	ASSERT_FALSE(fn);
+}